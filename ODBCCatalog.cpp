@@ -0,0 +1,187 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCHandles.h"
+
+ODBCCatalogEntry::ODBCCatalogEntry() : count(0), total_time(0), max_time(0)
+{
+}
+
+ODBCCatalogStats::ODBCCatalogStats() : dropped(0)
+{
+}
+
+void ODBCCatalogStats::record(const std::string &pattern, const std::string &request, long long elapsed)
+{
+	ODBCCatalogEntry *entry = &patterns[pattern];
+	entry->count++;
+	entry->total_time += elapsed;
+	if (elapsed > entry->max_time)
+		entry->max_time = elapsed;
+
+	auto it = requests.find(request);
+	if (it == requests.end())
+	{
+		if (requests.size() >= ODBCCATALOG_MAXREQUESTS)
+		{
+			dropped++;
+			return;
+		}
+		it = requests.insert(std::make_pair(request, ODBCCatalogEntry())).first;
+	}
+	it->second.count++;
+	it->second.total_time += elapsed;
+	if (elapsed > it->second.max_time)
+		it->second.max_time = elapsed;
+}
+
+bool ODBCCatalogStats::empty()
+{
+	return patterns.empty();
+}
+
+static bool compareTotalTime(const std::pair<std::string, ODBCCatalogEntry> &a, const std::pair<std::string, ODBCCatalogEntry> &b)
+{
+	return a.second.total_time > b.second.total_time;
+}
+
+void ODBCCatalogStats::report(const std::string &connection)
+{
+	std::string prefix = std::to_string(ODBCProcessId()) + " catalog " + connection + " ";
+
+	std::vector<std::pair<std::string, ODBCCatalogEntry> > sorted(patterns.begin(), patterns.end());
+	std::sort(sorted.begin(), sorted.end(), compareTotalTime);
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		ODBCCatalogEntry *entry = &sorted[i].second;
+		ODBCWriteLog(prefix + sorted[i].first + " " + ODBCFormatNumber(entry->count) + " Calls " +
+			ODBCFormatNumber(entry->total_time / 1000) + "ms (max " + ODBCFormatNumber(entry->max_time / 1000) + "ms)");
+	}
+
+	// Identical requests issued more than once on the same connection
+	// returned metadata the client could have cached.
+	sorted.clear();
+	for (auto it = requests.begin(); it != requests.end(); ++it)
+		if (it->second.count > 1)
+			sorted.push_back(*it);
+	std::sort(sorted.begin(), sorted.end(), compareTotalTime);
+	prefix = std::to_string(ODBCProcessId()) + " catalog-repeat " + connection + " ";
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		ODBCCatalogEntry *entry = &sorted[i].second;
+		ODBCWriteLog(prefix + sorted[i].first + " " + ODBCFormatNumber(entry->count) + " Calls " +
+			ODBCFormatNumber(entry->total_time / 1000) + "ms");
+	}
+
+	if (dropped > 0)
+		ODBCWriteLog(prefix + ODBCFormatNumber(dropped) + " Calls not tracked (request table full)");
+}
+
+bool ODBCIsCatalogCall(int function_id)
+{
+	switch (function_id)
+	{
+	case SQL_API_SQLTABLES:
+	case SQL_API_SQLCOLUMNS:
+	case SQL_API_SQLSTATISTICS:
+	case SQL_API_SQLPRIMARYKEYS:
+	case SQL_API_SQLGETTYPEINFO:
+	case SQL_API_SQLGETINFO:
+		return true;
+	}
+	return false;
+}
+
+// Builds the exact request text and its argument pattern, where names are
+// replaced by their class: null, '' (empty), % (match all), pattern or name.
+static void catalogKeys(ODBCTraceCall *call, std::string &pattern, std::string &request)
+{
+	pattern = std::string(call->function_name) + "(";
+	request = pattern;
+	bool first = true;
+
+	for (int i = 0; i < call->arguments_count; i++)
+	{
+		ODBCTraceArgument *arg = &call->arguments[i];
+		std::string exact, kind;
+
+		if (arg->type == TYP_SQLCHAR_PTR || arg->type == TYP_SQLWCHAR_PTR)
+		{
+			ODBCTraceArgument *length = i + 1 < call->arguments_count ? &call->arguments[++i] : NULL;
+			if (arg->value == NULL)
+			{
+				exact = kind = "null";
+			}
+			else
+			{
+				std::string name = ODBCArgumentString(arg, length);
+				exact = "'" + name + "'";
+				if (name.empty())
+					kind = "''";
+				else if (name == "%")
+					kind = "%";
+				else if (name.find('%') != std::string::npos)
+					kind = "pattern";
+				else
+					kind = "name";
+			}
+		}
+		else if (arg->type == TYP_SQLSMALLINT || arg->type == TYP_SQLUSMALLINT)
+		{
+			exact = kind = std::to_string((SQLSMALLINT)(intptr_t)arg->value);
+		}
+		else if (arg->type == TYP_SQLPOINTER)
+		{
+			// Output buffers follow, nothing of them identifies the request
+			break;
+		}
+		else
+		{
+			continue;
+		}
+
+		if (!first)
+		{
+			pattern.append(",");
+			request.append(",");
+		}
+		first = false;
+		pattern.append(kind);
+		request.append(exact);
+	}
+
+	pattern.append(")");
+	request.append(")");
+}
+
+void ODBCCatalogTrace(ODBCTraceCall *call)
+{
+	long long elapsed = call->end_time - call->begin_time;
+
+	std::shared_ptr<ODBCConnectionState> connection;
+	ODBCTraceArgument *handle = &call->arguments[0];
+	if (handle->type == TYP_SQLHDBC)
+		connection = ODBCHandleTable::get()->connection(handle->value);
+	else
+		connection = ODBCHandleTable::get()->statementConnection(handle->value);
+
+	std::string pattern, request;
+	catalogKeys(call, pattern, request);
+
+	MutexGuard guard(&connection->lock);
+	connection->catalog.record(pattern, request, elapsed);
+
+	// Names the driver in the concurrency analysis and the data source for
+	// the statement filter
+	if (call->function_id == SQL_API_SQLGETINFO && SQL_SUCCEEDED(call->retcode) && call->arguments[2].value)
+	{
+		SQLUSMALLINT info = (SQLUSMALLINT)(intptr_t)call->arguments[1].value;
+		std::string *name = info == SQL_DRIVER_NAME ? &connection->driver : info == SQL_DATA_SOURCE_NAME ? &connection->dsn : NULL;
+		if (name != NULL && call->unicode)
+			*name = ODBCNarrow((SQLWCHAR*)call->arguments[2].value, -1);
+		else if (name != NULL)
+			*name = (char*)call->arguments[2].value;
+	}
+}
@@ -0,0 +1,34 @@
+#if !defined(ODBCCATALOG_H)
+#define ODBCCATALOG_H
+
+// Upper bound of distinct exact requests remembered per connection.
+#define ODBCCATALOG_MAXREQUESTS 4096
+
+struct ODBCCatalogEntry
+{
+	ODBCCatalogEntry();
+	int count;
+	long long total_time;
+	long long max_time;
+};
+
+// Aggregated catalog/metadata calls of one connection. Calls are counted
+// per function and argument pattern, and per exact request so that repeated
+// identical requests the client could have cached can be reported.
+class ODBCCatalogStats
+{
+public:
+	ODBCCatalogStats();
+	void record(const std::string &pattern, const std::string &request, long long elapsed);
+	void report(const std::string &connection);
+	bool empty();
+private:
+	std::map<std::string, ODBCCatalogEntry> patterns;
+	std::map<std::string, ODBCCatalogEntry> requests;
+	int dropped;
+};
+
+bool ODBCIsCatalogCall(int function_id);
+void ODBCCatalogTrace(ODBCTraceCall *call);
+
+#endif //#if !defined(ODBCCATALOG_H)
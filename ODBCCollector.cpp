@@ -0,0 +1,147 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCCollector.h"
+#include "ODBCConfig.h"
+
+#include <chrono>
+
+ODBCCollector* ODBCCollector::inst;
+ODBCCollector* ODBCCollector::get()
+{
+	if (inst == NULL)
+		inst = new ODBCCollector();
+	return inst;
+}
+
+ODBCCollector::ODBCCollector() : count(0), sequence(0), dropped(0), stopping(false), connected(false), next_attempt(0)
+{
+}
+
+void ODBCCollector::open(const std::string &fallback, const std::string &endpoint)
+{
+	if (sender.joinable())
+		return;
+	this->fallback = fallback;
+	this->endpoint = endpoint;
+	stopping = false;
+	next_attempt = 0;
+	sender = std::thread(&ODBCCollector::run, this);
+}
+
+void ODBCCollector::close()
+{
+	if (!sender.joinable())
+		return;
+	stopping = true;
+	sender.join();
+	if (connected)
+	{
+		ODBCPipeClose(&pipe);
+		connected = false;
+	}
+}
+
+// Appends one record, the caller holds the lock.
+void ODBCCollector::append(std::vector<char> &records, const std::string &line)
+{
+	ODBCCollectorRecord record;
+	record.time = ODBCWallClockMilliseconds();
+	record.sequence = sequence++;
+	record.length = (uint32_t)line.size();
+	records.insert(records.end(), (const char*)&record, (const char*)&record + sizeof(record));
+	records.insert(records.end(), line.begin(), line.end());
+}
+
+void ODBCCollector::write(const std::string &line)
+{
+	MutexGuard guard(&lock);
+	if (buffer.size() + sizeof(ODBCCollectorRecord) + line.size() > ODBCCOLLECTOR_MAXBUFFER)
+	{
+		dropped++;
+		return;
+	}
+	append(buffer, line);
+	count++;
+}
+
+void ODBCCollector::run()
+{
+	while (!stopping)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(ODBCCOLLECTOR_INTERVAL));
+		flush();
+	}
+	flush();
+}
+
+void ODBCCollector::flush()
+{
+	std::vector<char> records;
+	unsigned int records_count;
+	{
+		MutexGuard guard(&lock);
+		if (dropped > 0)
+		{
+			append(buffer, ODBCFormatLine(std::to_string(ODBCProcessId()) + " collector " + ODBCFormatNumber(dropped) + " Lines dropped"));
+			count++;
+			dropped = 0;
+		}
+		records.swap(buffer);
+		records_count = count;
+		count = 0;
+	}
+	if (records_count > 0)
+		send(records, records_count);
+}
+
+void ODBCCollector::send(const std::vector<char> &records, unsigned int count)
+{
+	long long now = ODBCTraceNow();
+	if (!connected && now >= next_attempt && !endpoint.empty())
+	{
+		connected = ODBCPipeConnect(endpoint, &pipe, ODBCCOLLECTOR_TIMEOUT);
+		if (!connected)
+			next_attempt = now + ODBCCOLLECTOR_RETRY * 1000LL;
+	}
+
+	if (connected)
+	{
+		ODBCCollectorBatch batch;
+		batch.magic = ODBCCOLLECTOR_MAGIC;
+		batch.version = ODBCCOLLECTOR_VERSION;
+		batch.reserved = 0;
+		batch.pid = (uint32_t)ODBCProcessId();
+		batch.count = count;
+		batch.size = (uint32_t)records.size();
+		if (ODBCPipeWrite(&pipe, &batch, sizeof(batch)) && ODBCPipeWrite(&pipe, records.data(), records.size()))
+			return;
+
+		// The collector went away, part of this batch may have reached it
+		ODBCPipeClose(&pipe);
+		connected = false;
+		next_attempt = now + ODBCCOLLECTOR_RETRY * 1000LL;
+	}
+	writeFallback(records);
+}
+
+void ODBCCollector::writeFallback(const std::vector<char> &records)
+{
+	FILE* file = fopen(fallback.c_str(), "a");
+	if (!file)
+		return;
+	// The file is of this process only, so it starts with the header a log
+	// file gets
+	if (ODBCConfig::current()->format == OUTPUT_CSV && fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0)
+		fprintf(file, "%s\n", ODBCCSV_HEADER);
+	for (size_t offset = 0; offset + sizeof(ODBCCollectorRecord) <= records.size(); )
+	{
+		ODBCCollectorRecord record;
+		memcpy(&record, &records[offset], sizeof(record));
+		offset += sizeof(record);
+		fwrite(&records[offset], 1, record.length, file);
+		fputc('\n', file);
+		offset += record.length;
+	}
+	fclose(file);
+}
@@ -0,0 +1,65 @@
+#if !defined(ODBCCOLLECTOR_H)
+#define ODBCCOLLECTOR_H
+
+#include <atomic>
+#include <thread>
+#include "ODBCCollectorProtocol.h"
+
+// Milliseconds between two batches sent to the collector.
+#define ODBCCOLLECTOR_INTERVAL 50
+// Milliseconds between two attempts to reach the collector.
+#define ODBCCOLLECTOR_RETRY 1000
+// Milliseconds a batch waits for a collector that stopped reading before
+// it goes to the fallback file.
+#define ODBCCOLLECTOR_TIMEOUT 1000
+// Bytes of records kept while the sender is behind, further lines are dropped.
+#define ODBCCOLLECTOR_MAXBUFFER (8 * 1024 * 1024)
+
+// Sends the log lines of this process to odbccollector instead of appending
+// them to the shared log file, at the endpoint the config file names or
+// else the default one of the user. Tracing threads only copy the line into a
+// buffer; a sender thread ships the buffer as one batch every
+// ODBCCOLLECTOR_INTERVAL. While the collector is not running the batches go
+// to a log file of this process only, so nothing is lost and no file is
+// shared with other processes. A collector that stops reading holds a batch
+// up for ODBCCOLLECTOR_TIMEOUT at most, then the sender falls back to the
+// file until its next attempt, so closing the log never hangs on it. A CSV
+// fallback file starts with the header; the merged file of the collector
+// gets none, it may hold the lines of processes in different formats.
+class ODBCCollector
+{
+private:
+	static ODBCCollector* inst;
+
+public:
+	static ODBCCollector* get();
+	ODBCCollector();
+	// Without an endpoint every batch goes to the fallback file.
+	void open(const std::string &fallback, const std::string &endpoint);
+	void close();
+	void write(const std::string &line);
+
+private:
+	void run();
+	void flush();
+	void send(const std::vector<char> &records, unsigned int count);
+	void writeFallback(const std::vector<char> &records);
+	void append(std::vector<char> &records, const std::string &line);
+
+	Mutex lock;
+	std::vector<char> buffer;
+	unsigned int count;
+	unsigned int sequence;
+	unsigned long long dropped;
+
+	// Owned by the sender thread
+	std::thread sender;
+	std::atomic<bool> stopping;
+	std::string fallback;
+	std::string endpoint;
+	ODBCPipe pipe;
+	bool connected;
+	long long next_attempt;
+};
+
+#endif //#if !defined(ODBCCOLLECTOR_H)
@@ -0,0 +1,80 @@
+#if !defined(ODBCCOLLECTORPROTOCOL_H)
+#define ODBCCOLLECTORPROTOCOL_H
+
+#include <stdint.h>
+#include <string>
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+// Traced processes send their log lines to odbccollector in batches over a
+// named pipe (Windows) or a Unix domain socket. A batch is an
+// ODBCCollectorBatch followed by `count` records, each an
+// ODBCCollectorRecord followed by `length` bytes of the line without its
+// newline. Records of one process are in sequence order; the collector
+// merges the processes by time. Fields are packed and in host byte order.
+
+#define ODBCCOLLECTOR_MAGIC 0x4C434F42
+#define ODBCCOLLECTOR_VERSION 1
+#if defined(_WIN32)
+#define ODBCCOLLECTOR_ENDPOINT "\\\\.\\pipe\\ODBCTracer.Collector."
+#else
+#define ODBCCOLLECTOR_ENDPOINT "ODBCTracer.Collector"
+// Directory of the endpoint without $XDG_RUNTIME_DIR, followed by the uid
+#define ODBCCOLLECTOR_DIRECTORY "/tmp/ODBCTracer."
+#endif
+// Largest batch a collector accepts, in bytes after the header.
+#define ODBCCOLLECTOR_MAXBATCH (16 * 1024 * 1024)
+
+#pragma pack(push, 1)
+struct ODBCCollectorBatch
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t pid;
+	uint32_t count;
+	uint32_t size;
+};
+
+struct ODBCCollectorRecord
+{
+	// Wall clock in milliseconds since 1970-01-01 UTC
+	int64_t time;
+	uint32_t sequence;
+	uint32_t length;
+};
+#pragma pack(pop)
+
+// The endpoint of the user's collector when none is configured, so the lines
+// of one user never reach the collector of another: a pipe named after the
+// user on Windows; elsewhere a socket in $XDG_RUNTIME_DIR, or in a directory
+// in /tmp only the user may enter. The collector creates that directory; a
+// directory another user made or may write to yields "", no endpoint.
+inline std::string ODBCCollectorDefaultEndpoint(bool create)
+{
+#if defined(_WIN32)
+	char user[256];
+	DWORD length = sizeof(user);
+	if (!GetUserNameA(user, &length))
+		return "";
+	return std::string(ODBCCOLLECTOR_ENDPOINT) + user;
+#else
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	if (runtime != NULL && runtime[0] == '/')
+		return std::string(runtime) + "/" + ODBCCOLLECTOR_ENDPOINT;
+
+	std::string directory = ODBCCOLLECTOR_DIRECTORY + std::to_string(getuid());
+	if (create)
+		mkdir(directory.c_str(), 0700);
+	struct stat status;
+	if (lstat(directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode) ||
+		status.st_uid != getuid() || (status.st_mode & 077) != 0)
+		return "";
+	return directory + "/" + ODBCCOLLECTOR_ENDPOINT;
+#endif
+}
+
+#endif //#if !defined(ODBCCOLLECTORPROTOCOL_H)
@@ -0,0 +1,124 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCHandles.h"
+#include "ODBCConcurrency.h"
+#include "ODBCConfig.h"
+
+ODBCConcurrencyEntry::ODBCConcurrencyEntry() : calls(0), overlapped(0), queued(0), overtook(0),
+	alone_calls(0), alone_time(0), busy_calls(0), busy_time(0)
+{
+}
+
+void ODBCConcurrencyEntry::add(const ODBCConcurrencyEntry &entry)
+{
+	calls += entry.calls;
+	overlapped += entry.overlapped;
+	queued += entry.queued;
+	overtook += entry.overtook;
+	alone_calls += entry.alone_calls;
+	alone_time += entry.alone_time;
+	busy_calls += entry.busy_calls;
+	busy_time += entry.busy_time;
+}
+
+ODBCConcurrency* ODBCConcurrency::inst;
+ODBCConcurrency* ODBCConcurrency::get()
+{
+	if (inst == NULL)
+		inst = new ODBCConcurrency();
+	return inst;
+}
+
+std::string ODBCConcurrency::driver(ODBCTraceCall *call)
+{
+	// The first handle argument leads to the connection and its driver
+	std::string driver;
+	for (int i = 0; i < call->arguments_count; i++)
+		if (call->arguments[i].type >= TYP_SQLHDESC && call->arguments[i].type <= TYP_SQLHANDLE)
+		{
+			driver = ODBCHandleTable::get()->driver(call->arguments[i].value);
+			break;
+		}
+	return driver.empty() ? "unknown" : driver;
+}
+
+void ODBCConcurrency::call(ODBCTraceCall *call)
+{
+	// Calls that entered before the analysis was switched on have no driver
+	if (!ODBCConfig::current()->concurrency || call->driver.empty())
+		return;
+
+	MutexGuard guard(&lock);
+	ODBCConcurrencyEntry *entry = &drivers[call->driver][call->function_name];
+	entry->calls++;
+	if (call->overlapped)
+		entry->overlapped++;
+	if (call->entered_busy && !call->overtook)
+		entry->queued++;
+	if (call->overtook)
+		entry->overtook++;
+	if (call->entered_busy)
+	{
+		entry->busy_calls++;
+		entry->busy_time += call->end_time - call->begin_time;
+	}
+	else if (!call->overlapped)
+	{
+		entry->alone_calls++;
+		entry->alone_time += call->end_time - call->begin_time;
+	}
+}
+
+static std::string concurrencyCounts(const ODBCConcurrencyEntry &entry)
+{
+	std::string counts = ODBCFormatNumber(entry.calls) + " Calls " + ODBCFormatNumber(entry.overlapped) + " Overlapped " +
+		ODBCFormatNumber(entry.queued) + " Queued " + ODBCFormatNumber(entry.overtook) + " Overtook";
+	if (entry.alone_calls > 0)
+		counts.append(" " + ODBCFormatNumber(entry.alone_time / entry.alone_calls) + "us alone");
+	if (entry.busy_calls > 0)
+		counts.append(" " + ODBCFormatNumber(entry.busy_time / entry.busy_calls) + "us entering busy");
+	return counts;
+}
+
+void ODBCConcurrency::report()
+{
+	MutexGuard guard(&lock);
+	std::string prefix = std::to_string(ODBCProcessId()) + " concurrency ";
+	for (auto driver = drivers.begin(); driver != drivers.end(); ++driver)
+	{
+		ODBCConcurrencyEntry total;
+		// Slowdown of each function, weighted by its calls entering busy, so
+		// that a mix of short and long calls does not count as one
+		double slowdown = 0;
+		unsigned long long weight = 0;
+		for (auto function = driver->second.begin(); function != driver->second.end(); ++function)
+		{
+			ODBCConcurrencyEntry *entry = &function->second;
+			total.add(*entry);
+			ODBCWriteLog(prefix + driver->first + " " + function->first + " " + concurrencyCounts(*entry));
+			if (entry->alone_calls > 0 && entry->busy_calls > 0 && entry->alone_time > 0)
+			{
+				slowdown += entry->busy_calls * (((double)entry->busy_time / entry->busy_calls) / ((double)entry->alone_time / entry->alone_calls));
+				weight += entry->busy_calls;
+			}
+		}
+
+		std::string verdict = "concurrent";
+		if (total.overlapped == 0)
+			verdict = "single-threaded";
+		else if (total.alone_calls < ODBCCONCURRENCY_MINCALLS || weight < ODBCCONCURRENCY_MINCALLS)
+			verdict = "undecided";
+		else
+		{
+			slowdown /= weight;
+			char ratio[32];
+			sprintf(ratio, " (%.1fx slower entering busy)", slowdown);
+			verdict = (slowdown >= ODBCCONCURRENCY_SLOWDOWN ? "serialized" : "concurrent") + std::string(ratio);
+		}
+		ODBCWriteLog(prefix + driver->first + " total " + concurrencyCounts(total) + " " + verdict);
+	}
+	drivers.clear();
+}
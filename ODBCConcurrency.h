@@ -0,0 +1,58 @@
+#if !defined(ODBCCONCURRENCY_H)
+#define ODBCCONCURRENCY_H
+
+// Calls a driver needs alone and entering busy before it is judged.
+#define ODBCCONCURRENCY_MINCALLS 10
+// A driver whose calls take this many times longer when they enter while
+// calls of other threads run than when they run alone serializes them.
+#define ODBCCONCURRENCY_SLOWDOWN 2.0
+
+struct ODBCConcurrencyEntry
+{
+	ODBCConcurrencyEntry();
+	void add(const ODBCConcurrencyEntry &entry);
+	unsigned long long calls;
+	// Ran while a call of another thread ran
+	unsigned long long overlapped;
+	// Entered while calls of other threads ran and returned after all of them
+	unsigned long long queued;
+	// Returned while a call of another thread that entered earlier still ran
+	unsigned long long overtook;
+	// Microseconds of the calls that overlapped no other and of those that
+	// entered while others ran
+	unsigned long long alone_calls;
+	long long alone_time;
+	unsigned long long busy_calls;
+	long long busy_time;
+};
+
+// Tells whether a driver runs the calls of different threads concurrently or
+// serializes them internally, when the log file name contains "_concurrency"
+// or ODBCConfig switches it on. The trace stack marks every call while it is
+// in flight, comparing it with the calls of other threads on the same driver
+// in flight with it, across all connections of the process. Calls queued
+// behind a lock in the driver return after the calls they entered behind and
+// take longer the more calls are ahead of them; as driver locks are rarely
+// fair, a queued call may still overtake another waiting one. A driver is
+// reported as serialized when its calls entering busy take
+// ODBCCONCURRENCY_SLOWDOWN times as long as those running alone. The counts
+// are reported per driver, named by SQLGetInfo(SQL_DRIVER_NAME) if the
+// application asked for it, and per function when the log is closed.
+class ODBCConcurrency
+{
+private:
+	static ODBCConcurrency* inst;
+
+public:
+	static ODBCConcurrency* get();
+	// Looked up when the call enters, calls are compared per driver.
+	std::string driver(ODBCTraceCall *call);
+	void call(ODBCTraceCall *call);
+	void report();
+
+private:
+	Mutex lock;
+	std::map<std::string, std::map<std::string, ODBCConcurrencyEntry> > drivers;
+};
+
+#endif //#if !defined(ODBCCONCURRENCY_H)
@@ -0,0 +1,379 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCConfig.h"
+#include "ODBCLoopDetector.h"
+#include "ODBCOverhead.h"
+#include "ODBCStatementFilter.h"
+#include "ODBCRepeatDetector.h"
+
+#include <chrono>
+
+static const ODBCConfig defaultConfig;
+std::atomic<const ODBCConfig*> ODBCConfig::published(&defaultConfig);
+
+ODBCConfig::ODBCConfig() : recordLogging(true), replayLogging(false), concurrency(false), format(OUTPUT_TEXT),
+	overhead_sample(ODBCOVERHEAD_SAMPLE), loop_iterations(ODBCLOOP_MINITERATIONS), loop_gap(ODBCLOOP_MAXGAP), loop_rows(ODBCLOOP_MAXROWS),
+	progress_rows(ODBCTRACE_PROGRESSROWS), progress_interval(ODBCTRACE_PROGRESSINTERVAL * 1000000LL),
+	breakdown_min(ODBCTRACE_BREAKDOWNMIN * 1000LL), repeat_window(ODBCREPEAT_WINDOW * 1000000LL)
+{
+}
+
+bool ODBCConfig::traced(int function_id) const
+{
+	return function_id < 0 || function_id >= ODBCCONFIG_FUNCTIONS || !disabled.test(function_id);
+}
+
+// The functions "disable" accepts, a W entry point goes by the name without W
+static const struct
+{
+	const char *name;
+	int function_id;
+} configFunctions[] = {
+	{ "SQLAllocConnect", SQL_API_SQLALLOCCONNECT },
+	{ "SQLAllocEnv", SQL_API_SQLALLOCENV },
+	{ "SQLAllocHandle", SQL_API_SQLALLOCHANDLE },
+	{ "SQLAllocStmt", SQL_API_SQLALLOCSTMT },
+	{ "SQLBindCol", SQL_API_SQLBINDCOL },
+	{ "SQLBindParameter", SQL_API_SQLBINDPARAMETER },
+	{ "SQLBrowseConnect", SQL_API_SQLBROWSECONNECT },
+	{ "SQLBulkOperations", SQL_API_SQLBULKOPERATIONS },
+	{ "SQLCancel", SQL_API_SQLCANCEL },
+	{ "SQLCloseCursor", SQL_API_SQLCLOSECURSOR },
+	{ "SQLColAttribute", SQL_API_SQLCOLATTRIBUTE },
+	{ "SQLColAttributes", SQL_API_SQLCOLATTRIBUTES },
+	{ "SQLColumnPrivileges", SQL_API_SQLCOLUMNPRIVILEGES },
+	{ "SQLColumns", SQL_API_SQLCOLUMNS },
+	{ "SQLConnect", SQL_API_SQLCONNECT },
+	{ "SQLCopyDesc", SQL_API_SQLCOPYDESC },
+	{ "SQLDataSources", SQL_API_SQLDATASOURCES },
+	{ "SQLDescribeCol", SQL_API_SQLDESCRIBECOL },
+	{ "SQLDescribeParam", SQL_API_SQLDESCRIBEPARAM },
+	{ "SQLDisconnect", SQL_API_SQLDISCONNECT },
+	{ "SQLDriverConnect", SQL_API_SQLDRIVERCONNECT },
+	{ "SQLEndTran", SQL_API_SQLENDTRAN },
+	{ "SQLError", SQL_API_SQLERROR },
+	{ "SQLExecDirect", SQL_API_SQLEXECDIRECT },
+	{ "SQLExecute", SQL_API_SQLEXECUTE },
+	{ "SQLExtendedFetch", SQL_API_SQLEXTENDEDFETCH },
+	{ "SQLFetch", SQL_API_SQLFETCH },
+	{ "SQLFetchScroll", SQL_API_SQLFETCHSCROLL },
+	{ "SQLForeignKeys", SQL_API_SQLFOREIGNKEYS },
+	{ "SQLFreeConnect", SQL_API_SQLFREECONNECT },
+	{ "SQLFreeEnv", SQL_API_SQLFREEENV },
+	{ "SQLFreeHandle", SQL_API_SQLFREEHANDLE },
+	{ "SQLFreeStmt", SQL_API_SQLFREESTMT },
+	{ "SQLGetConnectAttr", SQL_API_SQLGETCONNECTATTR },
+	{ "SQLGetConnectOption", SQL_API_SQLGETCONNECTOPTION },
+	{ "SQLGetCursorName", SQL_API_SQLGETCURSORNAME },
+	{ "SQLGetData", SQL_API_SQLGETDATA },
+	{ "SQLGetDiagField", SQL_API_SQLGETDIAGFIELD },
+	{ "SQLGetDiagRec", SQL_API_SQLGETDIAGREC },
+	{ "SQLGetEnvAttr", SQL_API_SQLGETENVATTR },
+	{ "SQLGetFunctions", SQL_API_SQLGETFUNCTIONS },
+	{ "SQLGetInfo", SQL_API_SQLGETINFO },
+	{ "SQLGetStmtAttr", SQL_API_SQLGETSTMTATTR },
+	{ "SQLGetStmtOption", SQL_API_SQLGETSTMTOPTION },
+	{ "SQLGetTypeInfo", SQL_API_SQLGETTYPEINFO },
+	{ "SQLMoreResults", SQL_API_SQLMORERESULTS },
+	{ "SQLNativeSql", SQL_API_SQLNATIVESQL },
+	{ "SQLNumParams", SQL_API_SQLNUMPARAMS },
+	{ "SQLNumResultCols", SQL_API_SQLNUMRESULTCOLS },
+	{ "SQLParamData", SQL_API_SQLPARAMDATA },
+	{ "SQLParamOptions", SQL_API_SQLPARAMOPTIONS },
+	{ "SQLPrepare", SQL_API_SQLPREPARE },
+	{ "SQLPrimaryKeys", SQL_API_SQLPRIMARYKEYS },
+	{ "SQLProcedureColumns", SQL_API_SQLPROCEDURECOLUMNS },
+	{ "SQLProcedures", SQL_API_SQLPROCEDURES },
+	{ "SQLPutData", SQL_API_SQLPUTDATA },
+	{ "SQLRowCount", SQL_API_SQLROWCOUNT },
+	{ "SQLSetConnectAttr", SQL_API_SQLSETCONNECTATTR },
+	{ "SQLSetConnectOption", SQL_API_SQLSETCONNECTOPTION },
+	{ "SQLSetCursorName", SQL_API_SQLSETCURSORNAME },
+	{ "SQLSetEnvAttr", SQL_API_SQLSETENVATTR },
+	{ "SQLSetPos", SQL_API_SQLSETPOS },
+	{ "SQLSetScrollOptions", SQL_API_SQLSETSCROLLOPTIONS },
+	{ "SQLSetStmtAttr", SQL_API_SQLSETSTMTATTR },
+	{ "SQLSetStmtOption", SQL_API_SQLSETSTMTOPTION },
+	{ "SQLSpecialColumns", SQL_API_SQLSPECIALCOLUMNS },
+	{ "SQLStatistics", SQL_API_SQLSTATISTICS },
+	{ "SQLTablePrivileges", SQL_API_SQLTABLEPRIVILEGES },
+	{ "SQLTables", SQL_API_SQLTABLES },
+	{ "SQLTransact", SQL_API_SQLTRANSACT }
+};
+
+static int configFunction(std::string name)
+{
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		for (size_t i = 0; i < sizeof(configFunctions) / sizeof(configFunctions[0]); i++)
+			if (name == configFunctions[i].name)
+				return configFunctions[i].function_id;
+		if (name.size() < 2 || name[name.size() - 1] != 'W')
+			break;
+		name.erase(name.size() - 1);
+	}
+	return -1;
+}
+
+static std::string configTrim(const std::string &text)
+{
+	size_t begin = text.find_first_not_of(" \t\r\n");
+	if (begin == std::string::npos)
+		return "";
+	return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+static bool configSwitch(const std::string &value, bool *setting)
+{
+	if (value == "on")
+		*setting = true;
+	else if (value == "off")
+		*setting = false;
+	else
+		return false;
+	return true;
+}
+
+static bool configNumber(const std::string &value, long long *setting)
+{
+	char *end;
+	long long number = strtoll(value.c_str(), &end, 10);
+	if (value.empty() || *end != 0 || number < 0)
+		return false;
+	*setting = number;
+	return true;
+}
+
+// A duration in microseconds: a number with the unit "us", "ms", "s" or "m",
+// or a plain number in the unit the setting had before units were accepted.
+static bool configDuration(const std::string &value, long long unit, long long *setting)
+{
+	static const struct
+	{
+		const char *suffix;
+		long long unit;
+	} units[] = { { "us", 1 }, { "ms", 1000 }, { "s", 1000000 }, { "m", 60000000 } };
+
+	char *end;
+	long long number = strtoll(value.c_str(), &end, 10);
+	if (value.empty() || end == value.c_str() || number < 0)
+		return false;
+	if (*end != 0)
+	{
+		size_t i = 0;
+		while (i < sizeof(units) / sizeof(units[0]) && strcmp(end, units[i].suffix) != 0)
+			i++;
+		if (i == sizeof(units) / sizeof(units[0]))
+			return false;
+		unit = units[i].unit;
+	}
+	*setting = number * unit;
+	return true;
+}
+
+// Formats a duration in the largest unit configDuration reads it back in.
+static std::string configFormatDuration(long long duration)
+{
+	if (duration == 0)
+		return "0";
+	if (duration % 60000000 == 0)
+		return std::to_string(duration / 60000000) + "m";
+	if (duration % 1000000 == 0)
+		return std::to_string(duration / 1000000) + "s";
+	if (duration % 1000 == 0)
+		return std::to_string(duration / 1000) + "ms";
+	return std::to_string(duration) + "us";
+}
+
+// Applies one "name = value" setting, false if it is not one.
+static bool configSetting(ODBCConfig *config, ODBCStatementFilter *filter, const std::string &name, const std::string &value)
+{
+	long long number;
+	if (name == "include" || name == "exclude")
+		return filter->add(name == "include", value);
+	if (name == "collector")
+	{
+		config->collector = value;
+		return !value.empty();
+	}
+	if (name == "records")
+		return configSwitch(value, &config->recordLogging);
+	if (name == "replay")
+		return configSwitch(value, &config->replayLogging);
+	if (name == "concurrency")
+		return configSwitch(value, &config->concurrency);
+	if (name == "format")
+	{
+		if (value == "text")
+			config->format = OUTPUT_TEXT;
+		else if (value == "json")
+			config->format = OUTPUT_JSON;
+		else if (value == "csv")
+			config->format = OUTPUT_CSV;
+		else
+			return false;
+		return true;
+	}
+	if (name == "disable")
+	{
+		std::bitset<ODBCCONFIG_FUNCTIONS> disabled;
+		size_t begin = value.find_first_not_of(", \t");
+		while (begin != std::string::npos)
+		{
+			size_t end = value.find_first_of(", \t", begin);
+			int function_id = configFunction(value.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+			if (function_id < 0 || function_id >= ODBCCONFIG_FUNCTIONS)
+				return false;
+			disabled.set(function_id);
+			begin = end == std::string::npos ? end : value.find_first_not_of(", \t", end);
+		}
+		config->disabled |= disabled;
+		return true;
+	}
+	if (name == "loop_gap")
+		return configDuration(value, 1, &config->loop_gap);
+	if (name == "progress_interval")
+		return configDuration(value, 1000000, &config->progress_interval);
+	if (name == "breakdown_min")
+		return configDuration(value, 1000, &config->breakdown_min);
+	if (name == "repeat_window")
+		return configDuration(value, 1000000, &config->repeat_window);
+	if (!configNumber(value, &number))
+		return false;
+	if (name == "overhead_sample")
+		config->overhead_sample = (unsigned int)number;
+	else if (name == "loop_iterations")
+		config->loop_iterations = (int)number;
+	else if (name == "loop_rows")
+		config->loop_rows = number;
+	else if (name == "progress_rows")
+		config->progress_rows = number;
+	else
+		return false;
+	return true;
+}
+
+ODBCConfigFile* ODBCConfigFile::inst;
+ODBCConfigFile* ODBCConfigFile::get()
+{
+	if (inst == NULL)
+		inst = new ODBCConfigFile();
+	return inst;
+}
+
+ODBCConfigFile::ODBCConfigFile() : modified(-1), stopping(false)
+{
+}
+
+void ODBCConfigFile::open(const std::string &path, const ODBCConfig &defaults)
+{
+	close();
+	this->path = path;
+	this->defaults = defaults;
+	modified = ODBCFileModified(path);
+	load(false);
+}
+
+void ODBCConfigFile::watch()
+{
+	for (size_t i = 0; i < messages.size(); i++)
+		ODBCWriteLog(messages[i]);
+	messages.clear();
+	stopping = false;
+	watcher = std::thread(&ODBCConfigFile::run, this);
+}
+
+void ODBCConfigFile::close()
+{
+	if (watcher.joinable())
+	{
+		stopping = true;
+		wake.notify_one();
+		watcher.join();
+	}
+}
+
+void ODBCConfigFile::run()
+{
+	while (!stopping)
+	{
+		{
+			std::unique_lock<std::mutex> guard(wake_lock);
+			wake.wait_for(guard, std::chrono::milliseconds(ODBCCONFIG_POLL), [this]() { return (bool)stopping; });
+		}
+		long long now = ODBCFileModified(path);
+		if (stopping || now == modified)
+			continue;
+		modified = now;
+		load(true);
+	}
+}
+
+// Reads the file over the settings of the log file name and publishes them.
+// The lines telling what was loaded are written right away on a reload, and
+// by watch() when the log has been opened.
+void ODBCConfigFile::load(bool reload)
+{
+	std::string prefix = std::to_string(ODBCProcessId()) + " config ";
+	ODBCConfig *config = new ODBCConfig(defaults);
+	ODBCStatementFilter *filter = new ODBCStatementFilter();
+	FILE *file = fopen(path.c_str(), "r");
+	if (file != NULL)
+	{
+		char buffer[1024];
+		for (int line = 1; fgets(buffer, sizeof(buffer), file) != NULL; line++)
+		{
+			std::string text = buffer;
+			size_t comment = text.find('#');
+			if (comment != std::string::npos)
+				text.erase(comment);
+			text = configTrim(text);
+			if (text.empty())
+				continue;
+			size_t equals = text.find('=');
+			if (equals == std::string::npos || !configSetting(config, filter, configTrim(text.substr(0, equals)), configTrim(text.substr(equals + 1))))
+				messages.push_back(prefix + path + ":" + std::to_string(line) + " ignored " + text);
+		}
+		fclose(file);
+	}
+	if (filter->rules() > 0)
+	{
+		filter->compile();
+		config->filter.reset(filter);
+	}
+	else
+		delete filter;
+
+	const ODBCConfig *previous = ODBCConfig::current();
+	ODBCConfig::published.store(config, std::memory_order_release);
+
+	if (file != NULL || reload)
+		messages.push_back(prefix + path + (file != NULL ? " loaded" : " removed") +
+			" records=" + (config->recordLogging ? "on" : "off") +
+			" replay=" + (config->replayLogging ? "on" : "off") +
+			" format=" + (config->format == OUTPUT_JSON ? "json" : config->format == OUTPUT_CSV ? "csv" : "text") +
+			" concurrency=" + (config->concurrency ? "on" : "off") +
+			" overhead_sample=" + std::to_string(config->overhead_sample) +
+			" loop_iterations=" + std::to_string(config->loop_iterations) +
+			" loop_gap=" + configFormatDuration(config->loop_gap) +
+			" loop_rows=" + std::to_string(config->loop_rows) +
+			" progress_rows=" + std::to_string(config->progress_rows) +
+			" progress_interval=" + configFormatDuration(config->progress_interval) +
+			" breakdown_min=" + configFormatDuration(config->breakdown_min) +
+			" repeat_window=" + configFormatDuration(config->repeat_window) +
+			" disabled=" + std::to_string(config->disabled.count()) +
+			" filter=" + std::to_string(config->filter ? config->filter->rules() : 0) +
+			(config->collector.empty() ? "" : " collector=" + config->collector));
+	if (!reload)
+		return;
+
+	// A log switching to CSV gets the header its readers look for
+	if (config->format == OUTPUT_CSV && previous->format != OUTPUT_CSV && !ODBCTraceOptions::get()->collector)
+		ODBCWriteLine(ODBCCSV_HEADER);
+	for (size_t i = 0; i < messages.size(); i++)
+		ODBCWriteLog(messages[i]);
+	messages.clear();
+}
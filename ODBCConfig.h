@@ -0,0 +1,122 @@
+#if !defined(ODBCCONFIG_H)
+#define ODBCCONFIG_H
+
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Milliseconds between two looks at the config file.
+#define ODBCCONFIG_POLL 1000
+// Function ids a config can disable, those of ODBC 3.8 included.
+#define ODBCCONFIG_FUNCTIONS 2048
+
+// The settings read while calls are traced. A snapshot never changes once it
+// is published, a reload publishes a new one instead: a call reads current()
+// once, a single atomic load without a lock, and keeps to the settings it got
+// even when another thread publishes new ones meanwhile.
+class ODBCStatementFilter;
+
+struct ODBCConfig
+{
+	ODBCConfig();
+	static const ODBCConfig* current() { return published.load(std::memory_order_acquire); }
+	// False for the functions the config disabled, whose calls are not traced.
+	bool traced(int function_id) const;
+	bool recordLogging;
+	bool replayLogging;
+	bool concurrency;
+	ODBCOutputFormat format;
+	// ODBCOverhead times one call in this many of a thread, none for 0
+	unsigned int overhead_sample;
+	// The ODBCLoopDetector thresholds
+	int loop_iterations;
+	long long loop_gap;
+	long long loop_rows;
+	// Progress lines of long fetches every this many records or
+	// microseconds, never for 0
+	long long progress_rows;
+	long long progress_interval;
+	// Statements taking at least this many microseconds get a breakdown
+	// line, none for 0
+	long long breakdown_min;
+	// ODBCRepeatDetector counts statements run again within this many
+	// microseconds, none for 0
+	long long repeat_window;
+	std::bitset<ODBCCONFIG_FUNCTIONS> disabled;
+	// Compiled from the include and exclude rules, NULL without any
+	std::shared_ptr<const ODBCStatementFilter> filter;
+	// Endpoint of odbccollector, empty for ODBCCollectorDefaultEndpoint
+	std::string collector;
+
+private:
+	friend class ODBCConfigFile;
+	static std::atomic<const ODBCConfig*> published;
+};
+
+// Publishes the settings of the log file name when the log is opened, and
+// reloads them from "<log file without extension>.config" whenever that file
+// changes, so they can be changed without restarting the application. The
+// file has one "name = value" line per setting over those of the log file
+// name, "#" starts a comment:
+//   records = on|off          counting fetched records, "_nc" turns it off
+//   replay = on|off           replay lines, "_replay"
+//   format = text|json|csv    format of the lines, "_json" and "_csv"
+//   concurrency = on|off      the ODBCConcurrency analysis, "_concurrency"
+//   overhead_sample = N       ODBCOverhead times one call in N, 0 none
+//   loop_iterations = N       ODBCLoopDetector thresholds
+//   loop_gap = T
+//   loop_rows = N
+//   progress_rows = N         progress line of a statement every N records
+//   progress_interval = T     or every T, 0 for never
+//   breakdown_min = T         breakdown line of statements taking T, 0 for
+//                             none
+//   repeat_window = T         ODBCRepeatDetector window, 0 for none
+//   disable = SQLGetData, ... functions whose calls are not traced, by the
+//                             name without W
+//   include = sql:<text>      statements traced, see ODBCStatementFilter,
+//   exclude = dsn:<name>      one rule a line
+//   exclude = process:<name>
+//   collector = <endpoint>    socket or pipe "_collector" sends to, as
+//                             "odbccollector -e" listens on
+// A duration T is a number with the unit us, ms, s or m, like "250ms" or
+// "60s". A plain number keeps the unit these settings were first read in:
+// microseconds for loop_gap, milliseconds for breakdown_min and seconds for
+// progress_interval and repeat_window.
+// Removing a line or the file returns to the setting of the log file name.
+// The collector, the timeline, the span export and the flush policy of the
+// log writer stay as the log was opened. Replaced snapshots are never freed,
+// a call may still read one; reloads are rare and a snapshot is small.
+class ODBCConfigFile
+{
+private:
+	static ODBCConfigFile* inst;
+
+public:
+	static ODBCConfigFile* get();
+	ODBCConfigFile();
+	// Publishes the settings before the log is opened, as they decide its
+	// format.
+	void open(const std::string &path, const ODBCConfig &defaults);
+	// Starts watching the file once the log is open.
+	void watch();
+	void close();
+
+private:
+	void run();
+	void load(bool reload);
+
+	std::string path;
+	ODBCConfig defaults;
+	long long modified;
+	std::vector<std::string> messages;
+
+	std::thread watcher;
+	std::atomic<bool> stopping;
+	std::mutex wake_lock;
+	std::condition_variable wake;
+};
+
+#endif //#if !defined(ODBCCONFIG_H)
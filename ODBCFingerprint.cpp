@@ -0,0 +1,155 @@
+#include "StdAfx.h"
+
+#include "ODBCFingerprint.h"
+
+static bool isIdentifierChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$' || c == '#' || c == '@' || (unsigned char)c >= 0x80;
+}
+
+static bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// Appends a ? placeholder, folding "?, ?" into one so value lists of any
+// length fingerprint the same.
+static size_t appendPlaceholder(char *out, size_t n)
+{
+	size_t i = n;
+	while (i > 0 && out[i - 1] == ' ')
+		i--;
+	if (i > 0 && out[i - 1] == ',')
+	{
+		size_t j = i - 1;
+		while (j > 0 && out[j - 1] == ' ')
+			j--;
+		if (j > 0 && out[j - 1] == '?')
+			return j;
+	}
+	out[n++] = '?';
+	return n;
+}
+
+size_t ODBCFingerprintNormalize(const char *sql, size_t length, char *out)
+{
+	size_t n = 0;
+	size_t i = 0;
+	bool space = false;
+
+	while (i < length)
+	{
+		char c = sql[i];
+
+		if (isSpace(c))
+		{
+			space = true;
+			i++;
+			continue;
+		}
+		if (c == '-' && i + 1 < length && sql[i + 1] == '-')
+		{
+			while (i < length && sql[i] != '\n')
+				i++;
+			space = true;
+			continue;
+		}
+		if (c == '/' && i + 1 < length && sql[i + 1] == '*')
+		{
+			i += 2;
+			while (i + 1 < length && !(sql[i] == '*' && sql[i + 1] == '/'))
+				i++;
+			i += 2;
+			space = true;
+			continue;
+		}
+
+		if (space && n > 0)
+			out[n++] = ' ';
+		space = false;
+
+		if (c == '\'')
+		{
+			// String literal, '' is an escaped quote
+			i++;
+			while (i < length)
+			{
+				if (sql[i] == '\'')
+				{
+					if (i + 1 < length && sql[i + 1] == '\'')
+						i += 2;
+					else
+						break;
+				}
+				else
+					i++;
+			}
+			i++;
+			n = appendPlaceholder(out, n);
+		}
+		else if (c == '"' || c == '[' || c == '`')
+		{
+			// Quoted identifiers are copied verbatim
+			char close = c == '[' ? ']' : c;
+			out[n++] = sql[i++];
+			while (i < length && sql[i] != close)
+				out[n++] = sql[i++];
+			if (i < length)
+				out[n++] = sql[i++];
+		}
+		else if (isDigit(c) || (c == '.' && i + 1 < length && isDigit(sql[i + 1])))
+		{
+			// Numeric or hex literal
+			while (i < length && (isIdentifierChar(sql[i]) || sql[i] == '.' ||
+				((sql[i] == '+' || sql[i] == '-') && (sql[i - 1] == 'e' || sql[i - 1] == 'E'))))
+				i++;
+			n = appendPlaceholder(out, n);
+		}
+		else if (isIdentifierChar(c))
+		{
+			while (i < length && isIdentifierChar(sql[i]))
+			{
+				char d = sql[i++];
+				out[n++] = d >= 'A' && d <= 'Z' ? d - 'A' + 'a' : d;
+			}
+		}
+		else if (c == '?')
+		{
+			n = appendPlaceholder(out, n);
+			i++;
+		}
+		else
+		{
+			out[n++] = c;
+			i++;
+		}
+	}
+	return n;
+}
+
+unsigned long long ODBCFingerprintHash(const char *text, size_t length)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (unsigned char)text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+ODBCFingerprint::ODBCFingerprint() : hash(0)
+{
+}
+
+ODBCFingerprint::ODBCFingerprint(const std::string &statement)
+{
+	text.resize(statement.length());
+	text.resize(ODBCFingerprintNormalize(statement.data(), statement.length(), &text[0]));
+	hash = ODBCFingerprintHash(text.data(), text.length());
+}
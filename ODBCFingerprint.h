@@ -0,0 +1,24 @@
+#if !defined(ODBCFINGERPRINT_H)
+#define ODBCFINGERPRINT_H
+
+#include <string>
+
+// Normalizes a statement so that executions differing only in literal values
+// share one text: literals become ?, comments are dropped, whitespace is
+// collapsed, keywords and identifiers are lowercased and IN (?, ?, ...) lists
+// collapse to a single ?. The result is never longer than the input, so out
+// may be a buffer of length bytes; returns the normalized length.
+size_t ODBCFingerprintNormalize(const char *sql, size_t length, char *out);
+
+// 64-bit FNV-1a hash of a normalized text.
+unsigned long long ODBCFingerprintHash(const char *text, size_t length);
+
+struct ODBCFingerprint
+{
+	ODBCFingerprint();
+	ODBCFingerprint(const std::string &statement);
+	unsigned long long hash;
+	std::string text;
+};
+
+#endif //#if !defined(ODBCFINGERPRINT_H)
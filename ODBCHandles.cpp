@@ -0,0 +1,385 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCHandles.h"
+#include "ODBCMetrics.h"
+#include "ODBCSpanExporter.h"
+
+ODBCConnectionState::ODBCConnectionState(SQLHDBC hdbc) : hdbc(hdbc), begin_time(ODBCTraceNow()), autocommit(true), span(NULL), transaction(NULL)
+{
+}
+
+std::string ODBCConnectionState::name()
+{
+	return name(hdbc);
+}
+
+std::string ODBCConnectionState::name(SQLHDBC hdbc)
+{
+	if (hdbc == NULL)
+		return "hdbc unknown";
+	char buffer[32];
+	sprintf(buffer, "hdbc %p", hdbc);
+	return buffer;
+}
+
+ODBCStatementState::ODBCStatementState(SQLHSTMT hstmt, SQLHDBC hdbc) : hstmt(hstmt), hdbc(hdbc), begin_time(0), record_count(0), progress_count(0), progress_time(0), driver_time(0), last_fetch(0), thread_id(0), cpu_start(-1), bytes(0), result_set(0), result_begin(0), result_records(0), row_count(-1), retcode(0), failed(false), timed_out(false), excluded(false)
+{
+	memset(gaps, 0, sizeof(gaps));
+}
+
+ODBCStatementState::~ODBCStatementState()
+{
+	// Freed while a statement was still open, e.g. by SQLDisconnect
+	if (statement != "")
+		ODBCMetrics::get()->statementClosed();
+}
+
+const ODBCFingerprint& ODBCStatementState::fingerprint()
+{
+	// Prepared statements are executed many times with the same text
+	if (cached_fingerprint.text.empty() || cached_statement != statement)
+	{
+		cached_fingerprint = ODBCFingerprint(statement);
+		cached_statement = statement;
+	}
+	return cached_fingerprint;
+}
+
+void ODBCStatementState::clear()
+{
+	record_count = 0;
+	progress_count = 0;
+	progress_time = 0;
+	driver_time = 0;
+	last_fetch = 0;
+	memset(gaps, 0, sizeof(gaps));
+	cpu_start = -1;
+	bytes = 0;
+	result_set = 0;
+	result_begin = 0;
+	result_records = 0;
+	row_count = -1;
+	retcode = 0;
+	failed = false;
+	timed_out = false;
+	excluded = false;
+	statement = "";
+}
+
+void ODBCStatementState::started(long long driver_time, unsigned long thread_id)
+{
+	this->driver_time = driver_time;
+	last_fetch = 0;
+	memset(gaps, 0, sizeof(gaps));
+	this->thread_id = thread_id;
+	cpu_start = ODBCThreadCpuTime();
+	result_set = 0;
+	row_count = -1;
+	timed_out = false;
+}
+
+long long ODBCStatementState::cpuTime(unsigned long thread_id)
+{
+	// A thread's CPU time says nothing about the work of another thread
+	if (cpu_start < 0 || thread_id != this->thread_id)
+		return -1;
+	return ODBCThreadCpuTime() - cpu_start;
+}
+
+void ODBCStatementState::fetched(long long begin, long long end)
+{
+	driver_time += end - begin;
+	if (last_fetch > 0)
+	{
+		int bucket = 0;
+		for (long long limit = 10; bucket < ODBCSTATEMENT_GAPBUCKETS - 1 && begin - last_fetch >= limit; limit *= 10)
+			bucket++;
+		gaps[bucket]++;
+	}
+	last_fetch = end;
+}
+
+ODBCHandleTable* ODBCHandleTable::inst;
+ODBCHandleTable* ODBCHandleTable::get()
+{
+	if (inst == NULL)
+		inst = new ODBCHandleTable();
+	return inst;
+}
+
+std::shared_ptr<ODBCConnectionState> ODBCHandleTable::connection(SQLHDBC hdbc)
+{
+	MutexGuard guard(&lock);
+	std::shared_ptr<ODBCConnectionState> &state = connections[hdbc];
+	if (!state)
+		state = std::make_shared<ODBCConnectionState>(hdbc);
+	return state;
+}
+
+std::shared_ptr<ODBCConnectionState> ODBCHandleTable::statementConnection(SQLHSTMT hstmt)
+{
+	return connection(statement(hstmt)->hdbc);
+}
+
+std::shared_ptr<ODBCStatementState> ODBCHandleTable::statement(SQLHSTMT hstmt, bool create)
+{
+	MutexGuard guard(&lock);
+	auto it = statements.find(hstmt);
+	if (it != statements.end())
+		return it->second;
+	if (!create)
+		return NULL;
+	// Statements allocated before tracing started belong to no known connection
+	std::shared_ptr<ODBCStatementState> state = std::make_shared<ODBCStatementState>(hstmt, (SQLHDBC)NULL);
+	statements[hstmt] = state;
+	return state;
+}
+
+void ODBCHandleTable::allocStatement(SQLHSTMT hstmt, SQLHDBC hdbc)
+{
+	MutexGuard guard(&lock);
+	statements[hstmt] = std::make_shared<ODBCStatementState>(hstmt, hdbc);
+}
+
+void ODBCHandleTable::freeStatement(SQLHSTMT hstmt)
+{
+	MutexGuard guard(&lock);
+	statements.erase(hstmt);
+}
+
+std::shared_ptr<ODBCConnectionState> ODBCHandleTable::releaseConnection(SQLHDBC hdbc)
+{
+	MutexGuard guard(&lock);
+	for (auto it = statements.begin(); it != statements.end(); )
+	{
+		if (it->second->hdbc == hdbc)
+			it = statements.erase(it);
+		else
+			++it;
+	}
+
+	auto it = connections.find(hdbc);
+	if (it == connections.end())
+		return NULL;
+	std::shared_ptr<ODBCConnectionState> state = it->second;
+	connections.erase(it);
+	return state;
+}
+
+std::vector<std::shared_ptr<ODBCConnectionState> > ODBCHandleTable::releaseAll()
+{
+	MutexGuard guard(&lock);
+	std::vector<std::shared_ptr<ODBCConnectionState> > released;
+	for (auto it = connections.begin(); it != connections.end(); ++it)
+		released.push_back(it->second);
+	connections.clear();
+	statements.clear();
+	return released;
+}
+
+std::vector<std::shared_ptr<ODBCConnectionState> > ODBCHandleTable::allConnections()
+{
+	MutexGuard guard(&lock);
+	std::vector<std::shared_ptr<ODBCConnectionState> > all;
+	for (auto it = connections.begin(); it != connections.end(); ++it)
+		all.push_back(it->second);
+	return all;
+}
+
+std::string ODBCHandleTable::driver(SQLHANDLE handle)
+{
+	MutexGuard guard(&lock);
+	auto stmt = statements.find(handle);
+	auto it = connections.find(stmt != statements.end() ? stmt->second->hdbc : handle);
+	if (it == connections.end())
+		return "";
+	MutexGuard connection_guard(&it->second->lock);
+	return it->second->driver;
+}
+
+std::string ODBCHandleTable::dsn(SQLHDBC hdbc)
+{
+	MutexGuard guard(&lock);
+	auto it = connections.find(hdbc);
+	if (it == connections.end())
+		return "";
+	MutexGuard connection_guard(&it->second->lock);
+	return it->second->dsn;
+}
+
+// The state is freed once the calls of other threads still holding it
+// returned.
+static void reportConnection(const std::shared_ptr<ODBCConnectionState> &state)
+{
+	if (!state)
+		return;
+	ODBCSpanExporter::get()->connectionClosed(state.get(), ODBCTraceNow());
+	MutexGuard guard(&state->lock);
+	state->loops.flush(state->name());
+	if (!state->catalog.empty())
+		state->catalog.report(state->name());
+}
+
+// The DSN keyword of a connection string, "" for DSN-less connections.
+// Keywords are case insensitive and values may be enclosed in braces.
+static std::string connectionDsn(const std::string &connection)
+{
+	size_t pos = 0;
+	while (pos < connection.size())
+	{
+		size_t equals = connection.find('=', pos);
+		if (equals == std::string::npos)
+			break;
+		std::string key = connection.substr(pos, equals - pos);
+		key.erase(0, key.find_first_not_of(" \t"));
+		key.erase(key.find_last_not_of(" \t") + 1);
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+		size_t end;
+		std::string value;
+		if (equals + 1 < connection.size() && connection[equals + 1] == '{')
+		{
+			end = connection.find('}', equals + 2);
+			value = connection.substr(equals + 2, end == std::string::npos ? std::string::npos : end - equals - 2);
+			end = end == std::string::npos ? end : connection.find(';', end);
+		}
+		else
+		{
+			end = connection.find(';', equals + 1);
+			value = connection.substr(equals + 1, end == std::string::npos ? std::string::npos : end - equals - 1);
+		}
+		if (key == "dsn")
+			return value;
+		if (end == std::string::npos)
+			break;
+		pos = end + 1;
+	}
+	return "";
+}
+
+static void endTransaction(ODBCConnectionState *state, SQLSMALLINT completion)
+{
+	MutexGuard guard(&state->lock);
+	ODBCSpanExporter::get()->transactionEnded(state, completion == SQL_COMMIT ? "commit" : "rollback", ODBCTraceNow());
+}
+
+void ODBCHandleTrace(ODBCTraceCall *call)
+{
+	ODBCHandleTable *handles = ODBCHandleTable::get();
+
+	switch (call->function_id)
+	{
+	case SQL_API_SQLALLOCHANDLE:
+	{
+		SQLSMALLINT type = (SQLSMALLINT)(intptr_t)call->arguments[0].value;
+		SQLHANDLE *output = (SQLHANDLE*)call->arguments[2].value;
+		if (type == SQL_HANDLE_STMT && SQL_SUCCEEDED(call->retcode) && output)
+			handles->allocStatement(*output, call->arguments[1].value);
+		break;
+	}
+	case SQL_API_SQLALLOCSTMT:
+	{
+		SQLHSTMT *output = (SQLHSTMT*)call->arguments[1].value;
+		if (SQL_SUCCEEDED(call->retcode) && output)
+			handles->allocStatement(*output, call->arguments[0].value);
+		break;
+	}
+	case SQL_API_SQLFREEHANDLE:
+	{
+		// A failed free leaves the handle alive
+		SQLSMALLINT type = (SQLSMALLINT)(intptr_t)call->arguments[0].value;
+		if (!SQL_SUCCEEDED(call->retcode))
+			break;
+		if (type == SQL_HANDLE_STMT)
+			handles->freeStatement(call->arguments[1].value);
+		else if (type == SQL_HANDLE_DBC)
+			reportConnection(handles->releaseConnection(call->arguments[1].value));
+		break;
+	}
+	case SQL_API_SQLFREESTMT:
+	{
+		if ((SQLUSMALLINT)(intptr_t)call->arguments[1].value == SQL_DROP && SQL_SUCCEEDED(call->retcode))
+			handles->freeStatement(call->arguments[0].value);
+		break;
+	}
+	case SQL_API_SQLDISCONNECT:
+	{
+		// Disconnecting frees all statements of the connection as well. A
+		// failed disconnect, with a transaction open or a call still
+		// running, leaves the connection and its statements alive.
+		if (SQL_SUCCEEDED(call->retcode))
+			reportConnection(handles->releaseConnection(call->arguments[0].value));
+		break;
+	}
+	case SQL_API_SQLENDTRAN:
+	case SQL_API_SQLTRANSACT:
+	{
+		if (!SQL_SUCCEEDED(call->retcode))
+			break;
+		// SQLTransact passes the connection, or none for the whole environment
+		SQLHANDLE hdbc = NULL;
+		SQLSMALLINT completion = (SQLSMALLINT)(intptr_t)call->arguments[2].value;
+		if (call->function_id == SQL_API_SQLTRANSACT)
+			hdbc = call->arguments[1].value;
+		else if ((SQLSMALLINT)(intptr_t)call->arguments[0].value == SQL_HANDLE_DBC)
+			hdbc = call->arguments[1].value;
+
+		if (hdbc != NULL)
+			endTransaction(handles->connection(hdbc).get(), completion);
+		else
+		{
+			std::vector<std::shared_ptr<ODBCConnectionState> > all = handles->allConnections();
+			for (size_t i = 0; i < all.size(); i++)
+				endTransaction(all[i].get(), completion);
+		}
+		break;
+	}
+	case SQL_API_SQLCONNECT:
+	case SQL_API_SQLDRIVERCONNECT:
+	{
+		if (!SQL_SUCCEEDED(call->retcode))
+			break;
+		// Known here without asking SQLGetInfo, so "include = dsn:" rules
+		// apply from the first statement. The output string of
+		// SQLDriverConnect names the DSN the driver manager completed.
+		std::string dsn;
+		if (call->function_id == SQL_API_SQLCONNECT)
+			dsn = ODBCArgumentString(&call->arguments[1], &call->arguments[2]);
+		else
+		{
+			dsn = connectionDsn(ODBCArgumentString(&call->arguments[2], &call->arguments[3]));
+			if (dsn.empty())
+				dsn = connectionDsn(ODBCArgumentString(&call->arguments[4], NULL));
+		}
+		if (dsn.empty())
+			break;
+		std::shared_ptr<ODBCConnectionState> state = handles->connection(call->arguments[0].value);
+		MutexGuard guard(&state->lock);
+		state->dsn = dsn;
+		break;
+	}
+	case SQL_API_SQLSETCONNECTATTR:
+	{
+		if (!SQL_SUCCEEDED(call->retcode) || (SQLINTEGER)(intptr_t)call->arguments[1].value != SQL_ATTR_AUTOCOMMIT)
+			break;
+		std::shared_ptr<ODBCConnectionState> state = handles->connection(call->arguments[0].value);
+		bool autocommit = (SQLULEN)(uintptr_t)call->arguments[2].value != SQL_AUTOCOMMIT_OFF;
+		// Switching autocommit on commits the open transaction
+		if (autocommit && !state->autocommit)
+			endTransaction(state.get(), SQL_COMMIT);
+		MutexGuard guard(&state->lock);
+		state->autocommit = autocommit;
+		break;
+	}
+	}
+}
+
+void ODBCHandleReport()
+{
+	std::vector<std::shared_ptr<ODBCConnectionState> > released = ODBCHandleTable::get()->releaseAll();
+	for (size_t i = 0; i < released.size(); i++)
+		reportConnection(released[i]);
+}
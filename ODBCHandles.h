@@ -0,0 +1,135 @@
+#if !defined(ODBCHANDLES_H)
+#define ODBCHANDLES_H
+
+#include <memory>
+
+#include "ODBCCatalog.h"
+#include "ODBCFingerprint.h"
+#include "ODBCLoopDetector.h"
+
+struct ODBCSpan;
+
+// Buckets of the gaps between two fetches of a statement: under 10us,
+// 100us, 1ms, 10ms, 100ms, 1s and longer.
+#define ODBCSTATEMENT_GAPBUCKETS 7
+
+// State kept for one connection handle while it is alive.
+struct ODBCConnectionState
+{
+	ODBCConnectionState(SQLHDBC hdbc);
+	std::string name();
+	// The name of a connection without its state, "hdbc unknown" for NULL.
+	static std::string name(SQLHDBC hdbc);
+	SQLHDBC hdbc;
+	Mutex lock;
+	ODBCCatalogStats catalog;
+	ODBCLoopDetector loops;
+	// SQL_DRIVER_NAME and SQL_DATA_SOURCE_NAME once the application asked
+	// SQLGetInfo for them, the DSN also from SQLConnect or SQLDriverConnect
+	std::string driver;
+	std::string dsn;
+	// First seen by the tracer
+	long long begin_time;
+	// Off after SQLSetConnectAttr(SQL_ATTR_AUTOCOMMIT), SQLEndTran then
+	// ends the transaction
+	bool autocommit;
+	// Open spans of the OTLP export, NULL until a statement needs them
+	ODBCSpan* span;
+	ODBCSpan* transaction;
+};
+
+// State of one statement handle, from SQLPrepare/SQLExecDirect to the call
+// closing its cursor. A statement is used by one thread at a time, so its
+// state needs no lock.
+struct ODBCStatementState
+{
+	ODBCStatementState(SQLHSTMT hstmt, SQLHDBC hdbc);
+	~ODBCStatementState();
+	const ODBCFingerprint& fingerprint();
+	// Its cursor was closed, the handle waits for the next statement.
+	void clear();
+	// Prepared or executed by the thread: a new statement starts, the call
+	// took that long.
+	void started(long long driver_time, unsigned long thread_id);
+	// Microseconds of CPU the thread used since the statement started, -1
+	// if another thread started it.
+	long long cpuTime(unsigned long thread_id);
+	// A fetch returned, the gap before it and its time are accounted.
+	void fetched(long long begin, long long end);
+	SQLHSTMT hstmt;
+	SQLHDBC hdbc;
+	std::string statement;
+	// Of the last SQLPrepare, SQLExecute starts it again once its cursor was
+	// closed
+	std::string prepared;
+	long long begin_time;
+	int record_count;
+	// Records and time of the last progress line, of the start before it
+	int progress_count;
+	long long progress_time;
+	// Microseconds spent in the driver by the calls on the statement, the
+	// rest of its time the application spent between them
+	long long driver_time;
+	// End of the last fetch and the gaps between fetches
+	long long last_fetch;
+	unsigned int gaps[ODBCSTATEMENT_GAPBUCKETS];
+	// Thread that started the statement and its CPU time then, -1 unknown
+	unsigned long thread_id;
+	long long cpu_start;
+	// Returned by SQLGetData
+	long long bytes;
+	// Result set of a batch being fetched, 0 for the first until
+	// SQLMoreResults moves on: when it started, the records fetched before
+	// it and the rows SQLRowCount reported for it, -1 unknown
+	int result_set;
+	long long result_begin;
+	int result_records;
+	long long row_count;
+	// Of SQLPrepare/SQLExecDirect, SQL_ERROR once a fetch failed
+	int retcode;
+	bool failed;
+	// SQLGetDiagRec or SQLError reported HYT00 or HYT01 for it
+	bool timed_out;
+	// By ODBCStatementFilter when it was prepared or executed
+	bool excluded;
+private:
+	std::string cached_statement;
+	ODBCFingerprint cached_fingerprint;
+};
+
+// Maps statement handles to their state and the connection they were
+// allocated on, so statement level calls can be accounted per connection.
+// The states are shared with the callers: a state freed by one thread, or
+// by closing the log, stays valid for the calls of other threads that hold
+// it until they returned.
+class ODBCHandleTable
+{
+private:
+	static ODBCHandleTable* inst;
+
+public:
+	static ODBCHandleTable* get();
+	std::shared_ptr<ODBCConnectionState> connection(SQLHDBC hdbc);
+	std::shared_ptr<ODBCConnectionState> statementConnection(SQLHSTMT hstmt);
+	std::shared_ptr<ODBCStatementState> statement(SQLHSTMT hstmt, bool create = true);
+	void allocStatement(SQLHSTMT hstmt, SQLHDBC hdbc);
+	void freeStatement(SQLHSTMT hstmt);
+	std::shared_ptr<ODBCConnectionState> releaseConnection(SQLHDBC hdbc);
+	std::vector<std::shared_ptr<ODBCConnectionState> > releaseAll();
+	// SQLEndTran on an environment ends the transactions of all connections
+	std::vector<std::shared_ptr<ODBCConnectionState> > allConnections();
+	// Driver of the connection a handle belongs to, empty while unknown.
+	// Creates no state, the handle may have just been freed.
+	std::string driver(SQLHANDLE handle);
+	std::string dsn(SQLHDBC hdbc);
+
+private:
+	Mutex lock;
+	std::map<SQLHDBC, std::shared_ptr<ODBCConnectionState> > connections;
+	std::map<SQLHSTMT, std::shared_ptr<ODBCStatementState> > statements;
+};
+
+void ODBCHandleTrace(ODBCTraceCall *call);
+void ODBCHandleReport();
+
+#endif //#if !defined(ODBCHANDLES_H)
@@ -0,0 +1,264 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCLogWriter.h"
+#include "ODBCUringFile.h"
+
+#include <chrono>
+
+ODBCLogWriter* ODBCLogWriter::inst;
+ODBCLogWriter* ODBCLogWriter::get()
+{
+	if (inst == NULL)
+		inst = new ODBCLogWriter();
+	return inst;
+}
+
+ODBCLogWriter::ODBCLogWriter() : file(NULL), uring(NULL), lines(0), last_flush(0), policy(FLUSH_LINES), every(1), sync(false), stopping(false), wakeup(false),
+	flushes(0), syscalls(0), flushed_lines(0), flushed_bytes(0), max_bytes(0), flush_time(0), max_flush_time(0), dropped(0)
+{
+}
+
+void ODBCLogWriter::open(const std::string &logfile)
+{
+	close();
+
+	MutexGuard guard(&lock);
+	this->logfile = logfile;
+	policy = FLUSH_LINES;
+	every = 1;
+	sync = logfile.find("_fsync") != std::string::npos;
+#if !defined(_WIN32)
+	if (logfile.find("_uring") != std::string::npos)
+		uring = new ODBCUringFile();
+#endif
+
+	size_t option = logfile.find("_flush");
+	if (option != std::string::npos)
+	{
+		const char *value = logfile.c_str() + option + 6;
+		char *unit;
+		long long number = strtoll(value, &unit, 10);
+		if (strncmp(value, "error", 5) == 0)
+			policy = FLUSH_ERROR;
+		else if (unit != value && number > 0)
+		{
+			policy = strncmp(unit, "ms", 2) == 0 ? FLUSH_INTERVAL : FLUSH_LINES;
+			every = number;
+		}
+	}
+
+	last_flush = ODBCTraceNow();
+	if (policy == FLUSH_INTERVAL || uring)
+	{
+		stopping = false;
+		wakeup = false;
+		flusher = std::thread(&ODBCLogWriter::run, this);
+	}
+}
+
+void ODBCLogWriter::close()
+{
+	if (flusher.joinable())
+	{
+		stopping = true;
+		wake.notify_one();
+		flusher.join();
+	}
+
+	MutexGuard guard(&lock);
+	if (flushes > 0 || !buffer.empty())
+	{
+		std::string report = std::to_string(ODBCProcessId()) + " writer " + ODBCFormatNumber(flushes) + " Flushes " +
+			ODBCFormatNumber(flushed_lines) + " Lines " + ODBCFormatNumber(flushed_bytes / (flushes ? flushes : 1)) +
+			" Bytes avg (max " + ODBCFormatNumber(max_bytes) + ") " + ODBCFormatNumber(flush_time / (flushes ? flushes : 1)) +
+			"us avg (max " + ODBCFormatNumber(max_flush_time) + "us) " + ODBCFormatNumber(syscalls) + " Syscalls " + backend();
+		if (dropped > 0)
+			report += " " + ODBCFormatNumber(dropped) + " Dropped";
+		buffer.append(ODBCFormatLine(report) + "\n");
+		lines++;
+	}
+	flush();
+	if (file)
+	{
+		if (sync)
+			ODBCFileSync(file);
+		fclose(file);
+		file = NULL;
+	}
+#if !defined(_WIN32)
+	if (uring)
+	{
+		if (sync)
+			uring->sync();
+		delete uring;
+		uring = NULL;
+	}
+#endif
+	flushes = flushed_lines = flushed_bytes = max_bytes = syscalls = 0;
+	flush_time = max_flush_time = 0;
+	dropped = 0;
+}
+
+// Names the way lines reach the file for the writer report.
+const char* ODBCLogWriter::backend()
+{
+#if !defined(_WIN32)
+	if (uring)
+		return uring->uring() ? "io_uring" : "write";
+#endif
+	return "stdio";
+}
+
+void ODBCLogWriter::write(const std::string &line)
+{
+	MutexGuard guard(&lock);
+	// Only "_uring" lets the buffer grow past ODBCLOGWRITER_MAXBUFFER, the
+	// other writers flush it right here
+	if (buffer.size() >= ODBCLOGWRITER_MAXPENDING)
+	{
+		dropped++;
+		return;
+	}
+	buffer.append(line);
+	buffer.push_back('\n');
+	lines++;
+	if (buffer.size() >= ODBCLOGWRITER_MAXBUFFER || (policy == FLUSH_LINES && lines >= every))
+		request();
+}
+
+void ODBCLogWriter::statementFailed()
+{
+	MutexGuard guard(&lock);
+	if (policy == FLUSH_ERROR)
+		request();
+}
+
+// Flushes now or has the flush thread do it, the caller holds the lock.
+void ODBCLogWriter::request()
+{
+	// io_uring cancels the writes of a thread that exits, and the threads of
+	// the application come and go, so only the flush thread submits them
+	if (uring == NULL)
+	{
+		flush();
+		return;
+	}
+	if (!wakeup.exchange(true))
+	{
+		wake.notify_one();
+		syscalls++;
+	}
+}
+
+void ODBCLogWriter::run()
+{
+	long long tick = policy == FLUSH_INTERVAL ? std::min<long long>(every, ODBCLOGWRITER_TICK) : ODBCLOGWRITER_TICK;
+	while (!stopping)
+	{
+		{
+			// A wake up lost between the check and the wait only costs one tick
+			std::unique_lock<std::mutex> guard(wake_lock);
+			wake.wait_for(guard, std::chrono::milliseconds(tick), [this]() { return wakeup || stopping; });
+		}
+		bool requested = wakeup.exchange(false);
+		{
+			MutexGuard guard(&lock);
+			if (!requested && !(policy == FLUSH_INTERVAL && ODBCTraceNow() - last_flush >= every * 1000))
+				continue;
+			if (uring == NULL)
+			{
+				flush();
+				continue;
+			}
+		}
+		submit();
+	}
+}
+
+// Takes the buffer under the lock and writes it through io_uring without
+// the lock, a write waiting for a free registered buffer then holds up only
+// the flush thread and not the tracing threads. Called by the flush thread,
+// the only one to touch the ODBCUringFile while it runs.
+void ODBCLogWriter::submit()
+{
+#if !defined(_WIN32)
+	long long begin;
+	unsigned int submitted;
+	{
+		MutexGuard guard(&lock);
+		begin = ODBCTraceNow();
+		last_flush = begin;
+		if (buffer.empty())
+			return;
+		pending.swap(buffer);
+		submitted = lines;
+		lines = 0;
+	}
+
+	unsigned long long before = uring->syscalls;
+	if (!uring->opened())
+		uring->open(logfile);
+	if (uring->opened())
+		uring->write(pending.data(), pending.size());
+
+	MutexGuard guard(&lock);
+	syscalls += uring->syscalls - before;
+	flushed(pending.size(), submitted, begin);
+	pending.clear();
+#endif
+}
+
+// Writes the buffer with a single write, the caller holds the lock.
+void ODBCLogWriter::flush()
+{
+	long long begin = ODBCTraceNow();
+	last_flush = begin;
+	if (buffer.empty())
+		return;
+
+#if !defined(_WIN32)
+	if (uring)
+	{
+		// Only once the flush thread has stopped
+		unsigned long long before = uring->syscalls;
+		if (!uring->opened())
+			uring->open(logfile);
+		if (uring->opened())
+			uring->write(buffer.data(), buffer.size());
+		syscalls += uring->syscalls - before;
+	}
+	else
+#endif
+	{
+		// Opened again after a failure, as every line used to open the file
+		if (file == NULL)
+		{
+			file = fopen(logfile.c_str(), "a");
+			if (file)
+				setvbuf(file, NULL, _IONBF, 0);
+			syscalls++;
+		}
+		if (file)
+		{
+			fwrite(buffer.data(), 1, buffer.size(), file);
+			syscalls++;
+		}
+	}
+
+	flushed(buffer.size(), lines, begin);
+	buffer.clear();
+	lines = 0;
+}
+
+// Counts a flush for the writer report, the caller holds the lock.
+void ODBCLogWriter::flushed(size_t bytes, unsigned int lines, long long begin)
+{
+	long long elapsed = ODBCTraceNow() - begin;
+	flushes++;
+	flushed_lines += lines;
+	flushed_bytes += bytes;
+	max_bytes = std::max<unsigned long long>(max_bytes, bytes);
+	flush_time += elapsed;
+	max_flush_time = std::max(max_flush_time, elapsed);
+}
@@ -0,0 +1,92 @@
+#if !defined(ODBCLOGWRITER_H)
+#define ODBCLOGWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class ODBCUringFile;
+
+// Bytes of lines kept between two flushes, a full buffer is always flushed.
+#define ODBCLOGWRITER_MAXBUFFER (1024 * 1024)
+// Bytes of lines kept while the flush thread of "_uring" falls behind, lines
+// beyond are dropped and counted.
+#define ODBCLOGWRITER_MAXPENDING (16 * 1024 * 1024)
+// Milliseconds the flush thread sleeps before it checks the interval again.
+#define ODBCLOGWRITER_TICK 50
+
+// When the buffered lines reach the log file, selected by the log file name:
+// "_flush<N>" every N lines, "_flush<T>ms" every T milliseconds and
+// "_flusherror" when a statement failed. Without any of them every line is
+// flushed, which keeps the log as current as it has always been. "_fsync"
+// additionally syncs the file to disk when the log is closed, and "_uring"
+// has the flush thread write through ODBCUringFile instead of stdio on POSIX
+// systems, so tracing threads never wait for a write. The flush thread
+// writes without holding the lock; should it fall behind by
+// ODBCLOGWRITER_MAXPENDING bytes, further lines are dropped and counted in
+// the writer report.
+enum ODBCFlushPolicy
+{
+	FLUSH_LINES,
+	FLUSH_INTERVAL,
+	FLUSH_ERROR
+};
+
+// Appends the log lines of this process to the log file. Lines are collected
+// in a buffer and written with one write per flush, so the file stays open
+// and a flush never tears a line.
+class ODBCLogWriter
+{
+private:
+	static ODBCLogWriter* inst;
+
+public:
+	static ODBCLogWriter* get();
+	ODBCLogWriter();
+	void open(const std::string &logfile);
+	void close();
+	void write(const std::string &line);
+	// A statement failed, its line has been written already.
+	void statementFailed();
+
+private:
+	void run();
+	void flush();
+	void submit();
+	void flushed(size_t bytes, unsigned int lines, long long begin);
+	void request();
+	const char* backend();
+
+	Mutex lock;
+	std::string logfile;
+	FILE* file;
+	ODBCUringFile* uring;
+	std::string buffer;
+	unsigned int lines;
+	// Lines the flush thread writes without holding the lock
+	std::string pending;
+	long long last_flush;
+
+	ODBCFlushPolicy policy;
+	long long every;
+	bool sync;
+
+	std::thread flusher;
+	std::atomic<bool> stopping;
+	std::atomic<bool> wakeup;
+	std::mutex wake_lock;
+	std::condition_variable wake;
+
+	// Reported when the log is closed
+	unsigned long long flushes;
+	unsigned long long syscalls;
+	unsigned long long flushed_lines;
+	unsigned long long flushed_bytes;
+	unsigned long long max_bytes;
+	long long flush_time;
+	long long max_flush_time;
+	unsigned long long dropped;
+};
+
+#endif //#if !defined(ODBCLOGWRITER_H)
@@ -0,0 +1,73 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCLoopDetector.h"
+#include "ODBCConfig.h"
+
+ODBCLoopRun::ODBCLoopRun() : fingerprint(0), iterations(0), loop(false), rows(0), total_time(0), first_begin(0), last_end(0)
+{
+}
+
+bool ODBCLoopDetector::statement(const ODBCConfig *config, const ODBCFingerprint &fingerprint, long long begin, long long end, long long rows, const std::string &connection)
+{
+	// Without counted records every result looks small enough
+	if (!config->recordLogging && !config->replayLogging)
+		return false;
+
+	ODBCLoopRun *run = NULL;
+	ODBCLoopRun *oldest = &runs[0];
+	for (int i = 0; i < ODBCLOOP_SLOTS; i++)
+	{
+		if (runs[i].iterations > 0 && runs[i].fingerprint == fingerprint.hash)
+			run = &runs[i];
+		if (runs[i].last_end < oldest->last_end)
+			oldest = &runs[i];
+	}
+
+	if (run != NULL && (begin - run->last_end > config->loop_gap || rows > config->loop_rows))
+		finish(run, connection);
+	if (rows > config->loop_rows)
+		return false;
+
+	if (run == NULL || run->iterations == 0)
+	{
+		if (run == NULL)
+		{
+			// Reuse the least recently executed slot
+			run = oldest;
+			finish(run, connection);
+		}
+		run->fingerprint = fingerprint.hash;
+		run->text = fingerprint.text;
+		run->first_begin = begin;
+	}
+
+	run->iterations++;
+	run->rows += rows;
+	run->total_time += end - begin;
+	run->last_end = end;
+	if (run->iterations >= config->loop_iterations)
+		run->loop = true;
+	return run->loop;
+}
+
+void ODBCLoopDetector::flush(const std::string &connection)
+{
+	for (int i = 0; i < ODBCLOOP_SLOTS; i++)
+		finish(&runs[i], connection);
+}
+
+void ODBCLoopDetector::finish(ODBCLoopRun *run, const std::string &connection)
+{
+	if (run->loop)
+	{
+		char average[32];
+		sprintf(average, "%.2f", (double)run->rows / run->iterations);
+		ODBCWriteLog(std::to_string(ODBCProcessId()) + " loop " + connection + " " +
+			ODBCFormatNumber(run->iterations) + " Iterations " +
+			ODBCFormatNumber(run->total_time / 1000) + "ms (" +
+			ODBCFormatNumber((run->last_end - run->first_begin) / 1000) + "ms elapsed) " +
+			average + " Recs/Iteration " + run->text);
+	}
+	*run = ODBCLoopRun();
+}
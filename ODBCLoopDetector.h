@@ -0,0 +1,49 @@
+#if !defined(ODBCLOOPDETECTOR_H)
+#define ODBCLOOPDETECTOR_H
+
+#include "ODBCFingerprint.h"
+
+// Fingerprints followed at the same time on one connection.
+#define ODBCLOOP_SLOTS 8
+// Defaults of the ODBCConfig thresholds: executions from which on a run of
+// one fingerprint counts as a loop, the largest gap between two executions of a
+// run in microseconds, and the largest result of a single execution that
+// still belongs to a run.
+#define ODBCLOOP_MINITERATIONS 20
+#define ODBCLOOP_MAXGAP 250000
+#define ODBCLOOP_MAXROWS 1
+
+struct ODBCConfig;
+
+struct ODBCLoopRun
+{
+	ODBCLoopRun();
+	unsigned long long fingerprint;
+	std::string text;
+	int iterations;
+	// Became a loop, its statements are suppressed and it gets a summary
+	bool loop;
+	long long rows;
+	long long total_time;
+	long long first_begin;
+	long long last_end;
+};
+
+// Detects N+1 query patterns on one connection: the same fingerprint executed
+// back to back with small results and short gaps. Once a run becomes a loop
+// its statements are no longer logged one by one; a single summary is written
+// when the run ends. Loops are not detected while neither records nor replay
+// lines are on, as the size of the results is then unknown.
+class ODBCLoopDetector
+{
+public:
+	// Returns true when the statement belongs to a detected loop and its own
+	// log line should be suppressed.
+	bool statement(const ODBCConfig *config, const ODBCFingerprint &fingerprint, long long begin, long long end, long long rows, const std::string &connection);
+	void flush(const std::string &connection);
+private:
+	void finish(ODBCLoopRun *run, const std::string &connection);
+	ODBCLoopRun runs[ODBCLOOP_SLOTS];
+};
+
+#endif //#if !defined(ODBCLOOPDETECTOR_H)
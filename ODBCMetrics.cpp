@@ -0,0 +1,214 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCMetrics.h"
+
+ODBCMetrics* ODBCMetrics::inst;
+ODBCMetrics* ODBCMetrics::get()
+{
+	if (inst == NULL)
+		inst = new ODBCMetrics();
+	return inst;
+}
+
+ODBCMetrics::ODBCMetrics() : segment(NULL), next_publish(0), fingerprints(ODBCMETRICS_TRACKED), last_statements(0), last_rows(0), last_publish(0)
+{
+	memset(last_calls, 0, sizeof(last_calls));
+}
+
+void ODBCMetrics::open()
+{
+	MutexGuard guard(&lock);
+	if (segment == NULL)
+	{
+		// Left behind by processes that crashed or never closed the log
+		ODBCSharedMemoryRemoveStale(ODBCMETRICS_NAME);
+		std::string name = ODBCMETRICS_NAME + std::to_string(ODBCProcessId());
+		bool mapped = ODBCSharedMemoryCreate(name, sizeof(ODBCMetricsSegment), &memory);
+#if defined(_WIN32)
+		if (!mapped)
+			mapped = ODBCSharedMemoryCreate(ODBCMETRICS_LOCALNAME + std::to_string(ODBCProcessId()), sizeof(ODBCMetricsSegment), &memory);
+#endif
+		if (!mapped)
+			return;
+		ODBCMetricsSegment *created = (ODBCMetricsSegment*)memory.address;
+
+		memset((void*)created, 0, sizeof(ODBCMetricsSegment));
+		created->version = ODBCMETRICS_VERSION;
+		created->size = sizeof(ODBCMetricsSegment);
+		created->pid = ODBCProcessId();
+		strncpy(created->process, ODBCProcessName().c_str(), sizeof(created->process) - 1);
+		created->start_time = ODBCWallClockMilliseconds() / 1000;
+		created->magic.store(ODBCMETRICS_MAGIC, std::memory_order_release);
+		segment = created;
+	}
+
+	// The segment stays mapped after TraceCloseLogFile, tracing may resume
+	segment->closed.store(0);
+	last_publish = ODBCTraceNow();
+	next_publish = last_publish + ODBCMETRICS_INTERVAL;
+}
+
+void ODBCMetrics::close()
+{
+	if (segment == NULL)
+		return;
+	publish(ODBCTraceNow());
+	segment->closed.store(1);
+}
+
+ODBCMetricsFunction* ODBCMetrics::function(ODBCTraceCall *call)
+{
+	int id = call->function_id;
+	int slot = id % ODBCMETRICS_FUNCTIONS;
+	for (int i = 0; i < ODBCMETRICS_FUNCTIONS; i++, slot = (slot + 1) % ODBCMETRICS_FUNCTIONS)
+	{
+		ODBCMetricsFunction *function = &segment->functions[slot];
+		int current = function->function_id.load(std::memory_order_acquire);
+		if (current == id)
+			return function;
+		if (current != 0)
+			continue;
+
+		MutexGuard guard(&lock);
+		current = function->function_id.load(std::memory_order_relaxed);
+		if (current == 0)
+		{
+			// ANSI and Unicode variants share the function id and slot
+			std::string name = call->function_name ? call->function_name : std::to_string(id);
+			if (call->unicode && name.length() > 1 && name[name.length() - 1] == 'W')
+				name.erase(name.length() - 1);
+			strncpy(function->name, name.c_str(), sizeof(function->name) - 1);
+			function->function_id.store(id, std::memory_order_release);
+			return function;
+		}
+		if (current == id)
+			return function;
+	}
+	return NULL;
+}
+
+void ODBCMetrics::call(ODBCTraceCall *call, long long end_time)
+{
+	if (segment == NULL)
+		return;
+
+	ODBCMetricsFunction *function = this->function(call);
+	if (function != NULL)
+	{
+		function->calls.fetch_add(1, std::memory_order_relaxed);
+		function->total_time.fetch_add(end_time - call->begin_time, std::memory_order_relaxed);
+		if (call->retcode != SQL_SUCCESS && call->retcode != SQL_SUCCESS_WITH_INFO && call->retcode != SQL_NO_DATA)
+			function->errors.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Whichever thread first sees the interval elapsed publishes the snapshot
+	long long next = next_publish.load(std::memory_order_relaxed);
+	if (end_time >= next && next_publish.compare_exchange_strong(next, end_time + ODBCMETRICS_INTERVAL))
+		publish(end_time);
+}
+
+void ODBCMetrics::statement(const ODBCFingerprint &fingerprint, long long elapsed, long long rows, bool failed, long long cpu)
+{
+	if (segment == NULL)
+		return;
+	int bucket = ODBCMetricsBucket(elapsed);
+	segment->statements.fetch_add(1, std::memory_order_relaxed);
+	segment->latency[bucket].fetch_add(1, std::memory_order_relaxed);
+	if (failed)
+		segment->statement_errors.fetch_add(1, std::memory_order_relaxed);
+
+	MutexGuard guard(&lock);
+	auto it = fingerprints.find(fingerprint.hash);
+	if (it == fingerprints.end())
+	{
+		ODBCMetricsFingerprint created;
+		memset(&created, 0, sizeof(created));
+		created.hash = fingerprint.hash;
+		strncpy(created.text, fingerprint.text.c_str(), sizeof(created.text) - 1);
+		it = fingerprints.insert(fingerprint.hash, created);
+	}
+	it->second.executions++;
+	it->second.total_time += elapsed;
+	it->second.rows += rows;
+	it->second.latency[bucket]++;
+	if (cpu >= 0)
+	{
+		it->second.cpu_time += cpu;
+		it->second.cpu_elapsed += elapsed;
+	}
+	if (failed)
+		it->second.errors++;
+}
+
+void ODBCMetrics::statementOpened()
+{
+	if (segment != NULL)
+		segment->in_flight.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ODBCMetrics::statementClosed()
+{
+	if (segment != NULL)
+		segment->in_flight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ODBCMetrics::fetched()
+{
+	if (segment != NULL)
+		segment->rows_fetched.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ODBCMetrics::written(size_t bytes)
+{
+	if (segment != NULL)
+		segment->bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static bool compareTotalTime(const ODBCMetricsFingerprint *a, const ODBCMetricsFingerprint *b)
+{
+	return a->total_time > b->total_time;
+}
+
+void ODBCMetrics::publish(long long now)
+{
+	MutexGuard guard(&lock);
+	double seconds = (now - last_publish) / 1000000.0;
+	if (seconds <= 0)
+		seconds = 1;
+	last_publish = now;
+
+	std::vector<const ODBCMetricsFingerprint*> top;
+	top.reserve(fingerprints.size());
+	for (auto it = fingerprints.begin(); it != fingerprints.end(); ++it)
+		top.push_back(&it->second);
+	size_t count = top.size() < ODBCMETRICS_FINGERPRINTS ? top.size() : ODBCMETRICS_FINGERPRINTS;
+	std::partial_sort(top.begin(), top.begin() + count, top.end(), compareTotalTime);
+
+	unsigned int sequence = segment->sequence.load(std::memory_order_relaxed);
+	segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	ODBCMetricsSnapshot *snapshot = &segment->snapshot;
+	snapshot->time = ODBCWallClockMilliseconds();
+	for (int i = 0; i < ODBCMETRICS_FUNCTIONS; i++)
+	{
+		unsigned long long calls = segment->functions[i].calls.load(std::memory_order_relaxed);
+		snapshot->calls_per_second[i] = (unsigned long long)((calls - last_calls[i]) / seconds);
+		last_calls[i] = calls;
+	}
+	unsigned long long statements = segment->statements.load(std::memory_order_relaxed);
+	snapshot->statements_per_second = (unsigned long long)((statements - last_statements) / seconds);
+	last_statements = statements;
+	unsigned long long rows = segment->rows_fetched.load(std::memory_order_relaxed);
+	snapshot->rows_per_second = (unsigned long long)((rows - last_rows) / seconds);
+	last_rows = rows;
+
+	snapshot->fingerprint_count = (unsigned int)count;
+	for (size_t i = 0; i < count; i++)
+		snapshot->fingerprints[i] = *top[i];
+
+	segment->sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,42 @@
+#if !defined(ODBCMETRICS_H)
+#define ODBCMETRICS_H
+
+#include "ODBCMetricsSegment.h"
+#include "ODBCFingerprint.h"
+#include "ODBCRecentMap.h"
+
+// Publishes the metrics of this process into its ODBCMetricsSegment.
+class ODBCMetrics
+{
+private:
+	static ODBCMetrics* inst;
+
+public:
+	static ODBCMetrics* get();
+	ODBCMetrics();
+	void open();
+	void close();
+	void call(ODBCTraceCall *call, long long end_time);
+	// The CPU time of the statement's thread is -1 if unknown.
+	void statement(const ODBCFingerprint &fingerprint, long long elapsed, long long rows, bool failed, long long cpu);
+	void statementOpened();
+	void statementClosed();
+	void fetched();
+	void written(size_t bytes);
+
+private:
+	ODBCMetricsFunction* function(ODBCTraceCall *call);
+	void publish(long long now);
+
+	ODBCMetricsSegment *segment;
+	ODBCSharedMemory memory;
+	Mutex lock;
+	std::atomic<long long> next_publish;
+	ODBCRecentMap<ODBCMetricsFingerprint> fingerprints;
+	unsigned long long last_calls[ODBCMETRICS_FUNCTIONS];
+	unsigned long long last_statements;
+	unsigned long long last_rows;
+	long long last_publish;
+};
+
+#endif //#if !defined(ODBCMETRICS_H)
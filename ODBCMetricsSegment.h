@@ -0,0 +1,131 @@
+#if !defined(ODBCMETRICSSEGMENT_H)
+#define ODBCMETRICSSEGMENT_H
+
+#include <atomic>
+#include <string.h>
+
+// Live metrics published by every traced process into a named shared memory
+// segment (ODBCMETRICS_NAME followed by the process id), so monitors can read
+// them without any I/O in the traced process. The layout is versioned; a
+// reader must check magic, version and size before using anything else.
+//
+// Counters are monotonic and updated with atomic adds, a reader may load them
+// at any time. The snapshot section is rewritten about once per second under
+// a sequence lock: the sequence is odd while it is being written, so a reader
+// copies it and retries until it read the same even sequence before and after.
+
+#define ODBCMETRICS_MAGIC 0x4D43424F
+#define ODBCMETRICS_VERSION 3
+#if defined(_WIN32)
+// Global, so a monitor in another session sees services as well. Creating a
+// global object takes SeCreateGlobalPrivilege; a process without it creates
+// the segment under the local name of its session, monitors try both.
+#define ODBCMETRICS_NAME "Global\\ODBCTracer.Metrics."
+#define ODBCMETRICS_LOCALNAME "Local\\ODBCTracer.Metrics."
+#else
+// POSIX shared memory, listed in /dev/shm without the leading slash
+#define ODBCMETRICS_NAME "/ODBCTracer.Metrics."
+#endif
+#define ODBCMETRICS_FUNCTIONS 64
+#define ODBCMETRICS_FINGERPRINTS 16
+#define ODBCMETRICS_TEXTLENGTH 256
+// Fingerprints aggregated in process to choose the published top ones from,
+// the one executed least recently makes room for a new one.
+#define ODBCMETRICS_TRACKED 1024
+// Interval of snapshot publication in microseconds.
+#define ODBCMETRICS_INTERVAL 1000000
+// Latency histogram buckets; bucket n > 0 holds durations below 2^n microseconds.
+#define ODBCMETRICS_BUCKETS 32
+
+typedef std::atomic<unsigned long long> ODBCMetricsCounter;
+
+struct ODBCMetricsFunction
+{
+	std::atomic<int> function_id;	// 0 while the slot is unused
+	char name[32];
+	ODBCMetricsCounter calls;
+	ODBCMetricsCounter errors;
+	ODBCMetricsCounter total_time;	// microseconds
+};
+
+struct ODBCMetricsFingerprint
+{
+	unsigned long long hash;
+	unsigned long long executions;
+	unsigned long long total_time;	// microseconds
+	unsigned long long rows;
+	unsigned long long errors;
+	unsigned long long latency[ODBCMETRICS_BUCKETS];
+	// CPU time of the statements' threads, and the elapsed time of the
+	// executions it is known for, in microseconds
+	unsigned long long cpu_time;
+	unsigned long long cpu_elapsed;
+	char text[ODBCMETRICS_TEXTLENGTH];
+};
+
+struct ODBCMetricsSnapshot
+{
+	long long time;					// publication, milliseconds since 1970
+	unsigned long long calls_per_second[ODBCMETRICS_FUNCTIONS];
+	unsigned long long statements_per_second;
+	unsigned long long rows_per_second;
+	unsigned int fingerprint_count;
+	ODBCMetricsFingerprint fingerprints[ODBCMETRICS_FINGERPRINTS];	// by total time
+};
+
+struct ODBCMetricsSegment
+{
+	std::atomic<unsigned int> magic;	// stored last when the segment is created
+	unsigned int version;
+	unsigned int size;
+	unsigned int pid;
+	char process[64];
+	long long start_time;			// seconds since 1970
+	std::atomic<unsigned int> closed;
+
+	ODBCMetricsCounter statements;
+	ODBCMetricsCounter statement_errors;
+	ODBCMetricsCounter latency[ODBCMETRICS_BUCKETS];	// of statements
+	std::atomic<long long> in_flight;
+	ODBCMetricsCounter rows_fetched;
+	ODBCMetricsCounter bytes_written;
+	ODBCMetricsFunction functions[ODBCMETRICS_FUNCTIONS];
+
+	std::atomic<unsigned int> sequence;
+	ODBCMetricsSnapshot snapshot;
+};
+
+inline int ODBCMetricsBucket(long long elapsed)
+{
+	int bucket = 0;
+	while (elapsed > 0 && bucket < ODBCMETRICS_BUCKETS - 1)
+	{
+		elapsed >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+// Upper bound of a histogram bucket in microseconds.
+inline long long ODBCMetricsBucketLimit(int bucket)
+{
+	return 1LL << bucket;
+}
+
+// Copies the snapshot section of a segment, false if it kept changing.
+inline bool ODBCMetricsReadSnapshot(const ODBCMetricsSegment *segment, ODBCMetricsSnapshot *snapshot)
+{
+	for (int attempt = 0; attempt < 100; attempt++)
+	{
+		unsigned int before = segment->sequence.load(std::memory_order_acquire);
+		if (before & 1)
+			continue;
+		memcpy(snapshot, &segment->snapshot, sizeof(ODBCMetricsSnapshot));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (segment->sequence.load(std::memory_order_relaxed) == before)
+			return true;
+	}
+	return false;
+}
+
+#endif //#if !defined(ODBCMETRICSSEGMENT_H)
@@ -0,0 +1,133 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCOverhead.h"
+#include "ODBCConfig.h"
+
+static thread_local bool thread_sampling;
+// The calls the sampled call of this thread stands for, the sampling rate
+// can change between two samples
+static thread_local unsigned int thread_weight;
+
+long long ODBCOverheadSample()
+{
+	// Counting down spares the division by a rate that is not a constant
+	static thread_local int countdown;
+	if (--countdown > 0)
+		return 0;
+	unsigned int every = ODBCConfig::current()->overhead_sample;
+	countdown = every;
+	if (every == 0)
+		return 0;
+	thread_weight = every;
+	return ODBCTraceNanoseconds();
+}
+
+ODBCOverhead* ODBCOverhead::inst;
+ODBCOverhead* ODBCOverhead::get()
+{
+	if (inst == NULL)
+		inst = new ODBCOverhead();
+	return inst;
+}
+
+ODBCOverhead::ODBCOverhead() : driver_time(0), sampled(0), calls(0), next_report(0), stack_lock(NULL), stack_wait_base(0), mutex_wait_base(0)
+{
+	for (int i = 0; i < OVERHEAD_PARTS; i++)
+		times[i] = 0;
+}
+
+void ODBCOverhead::open(Mutex *stack_lock)
+{
+	for (int i = 0; i < OVERHEAD_PARTS; i++)
+		times[i] = 0;
+	driver_time = 0;
+	sampled = 0;
+	calls = 0;
+	this->stack_lock = stack_lock;
+	stack_wait_base = stack_lock->wait_time;
+	mutex_wait_base = Mutex::total_wait_time;
+	next_report = ODBCTraceNanoseconds() + ODBCOVERHEAD_INTERVAL;
+}
+
+void ODBCOverhead::close()
+{
+	if (stack_lock == NULL)
+		return;
+	report();
+	stack_lock = NULL;
+}
+
+void ODBCOverhead::add(ODBCOverheadPart part, long long time)
+{
+	times[part].fetch_add(time * thread_weight, std::memory_order_relaxed);
+}
+
+void ODBCOverhead::hooked(ODBCTraceCall *call, long long now)
+{
+	times[OVERHEAD_HOOK].fetch_add((now - call->hook_time) * thread_weight, std::memory_order_relaxed);
+	call->driver_time = now;
+}
+
+void ODBCOverhead::returned(ODBCTraceCall *call, long long now)
+{
+	driver_time.fetch_add((now - call->driver_time) * thread_weight, std::memory_order_relaxed);
+	thread_sampling = true;
+}
+
+bool ODBCOverhead::sampling()
+{
+	return thread_sampling;
+}
+
+void ODBCOverhead::finished(long long start, long long now)
+{
+	thread_sampling = false;
+	times[OVERHEAD_RETURN].fetch_add((now - start) * thread_weight, std::memory_order_relaxed);
+	sampled.fetch_add(1, std::memory_order_relaxed);
+	calls.fetch_add(thread_weight, std::memory_order_relaxed);
+
+	long long next = next_report.load(std::memory_order_relaxed);
+	if (now >= next && next_report.compare_exchange_strong(next, now + ODBCOVERHEAD_INTERVAL))
+		report();
+}
+
+static std::string overheadMicroseconds(long long nanoseconds, const char *name)
+{
+	return ODBCFormatNumber(nanoseconds / 1000) + "us " + name;
+}
+
+// "<pid> overhead C Calls (S timed) Xus Hooks Xus TraceReturn Xus Trace
+// Xus Writes Xus StackWait Xus MutexWait Xus Total Xus Driver P%". Writes
+// and Trace are part of TraceReturn, the waits part of Hooks and
+// TraceReturn, whose sum is the total.
+void ODBCOverhead::report()
+{
+	Mutex *stack_lock = this->stack_lock;
+	if (stack_lock == NULL)
+		return;
+
+	unsigned long long timed = sampled;
+	long long part[OVERHEAD_PARTS];
+	for (int i = 0; i < OVERHEAD_PARTS; i++)
+		part[i] = times[i];
+	long long total = part[OVERHEAD_HOOK] + part[OVERHEAD_RETURN];
+	long long driver = driver_time;
+
+	char percent[32];
+	if (driver > 0)
+		sprintf(percent, "%.2f%%", 100.0 * total / driver);
+	else
+		sprintf(percent, "-%%");
+
+	ODBCWriteLog(std::to_string(ODBCProcessId()) + " overhead " + ODBCFormatNumber(calls) + " Calls (" +
+		ODBCFormatNumber(timed) + " timed) " +
+		overheadMicroseconds(part[OVERHEAD_HOOK], "Hooks ") +
+		overheadMicroseconds(part[OVERHEAD_RETURN], "TraceReturn ") +
+		overheadMicroseconds(part[OVERHEAD_TRACE], "Trace ") +
+		overheadMicroseconds(part[OVERHEAD_WRITE], "Writes ") +
+		overheadMicroseconds(stack_lock->wait_time - stack_wait_base, "StackWait ") +
+		overheadMicroseconds(Mutex::total_wait_time - mutex_wait_base, "MutexWait ") +
+		overheadMicroseconds(total, "Total ") +
+		overheadMicroseconds(driver, "Driver ") + percent);
+}
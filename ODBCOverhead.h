@@ -0,0 +1,68 @@
+#if !defined(ODBCOVERHEAD_H)
+#define ODBCOVERHEAD_H
+
+#include <atomic>
+
+// Nanoseconds between two overhead lines while the log is open.
+#define ODBCOVERHEAD_INTERVAL (60 * 1000000000LL)
+// Every this many calls of a thread one is timed, unless ODBCConfig says
+// otherwise. Reading the clock costs tens of nanoseconds, timing every call
+// would double the tracer's cost.
+#define ODBCOVERHEAD_SAMPLE 16
+
+enum ODBCOverheadPart
+{
+	// Trace* hooks building the call and pushing it, stack lock included
+	OVERHEAD_HOOK,
+	// TraceReturn with everything it runs, ODBCTrace included
+	OVERHEAD_RETURN,
+	// ODBCTrace keeping state and formatting lines, log writes included
+	OVERHEAD_TRACE,
+	// ODBCWriteLine handing lines to the log writer or the collector
+	OVERHEAD_WRITE,
+	OVERHEAD_PARTS
+};
+
+// Accounts the time the tracer spends in the application's threads against
+// the time the calls spend in the driver (and the driver manager) between
+// the hook and TraceReturn. Both are summed over the sampled calls of all
+// threads, each scaled up to the calls it stands for; mutex waits are
+// measured for every wait. The totals since the log was opened are written
+// as an "overhead" line every ODBCOVERHEAD_INTERVAL and when it is closed.
+class ODBCOverhead
+{
+private:
+	static ODBCOverhead* inst;
+
+public:
+	static ODBCOverhead* get();
+	ODBCOverhead();
+	// The lock of the trace stack, whose waits are reported on their own
+	void open(Mutex *stack_lock);
+	void close();
+	void add(ODBCOverheadPart part, long long time);
+	// The hook of a sampled call hands it on to the driver.
+	void hooked(ODBCTraceCall *call, long long now);
+	// A sampled call returned from the driver, the tracer takes over again.
+	void returned(ODBCTraceCall *call, long long now);
+	// TraceReturn is done with a sampled call.
+	void finished(long long start, long long now);
+	// This thread is in TraceReturn for a sampled call.
+	bool sampling();
+	// Writes the overhead line, from TraceReturn every interval.
+	void report();
+
+private:
+	std::atomic<long long> times[OVERHEAD_PARTS];
+	std::atomic<long long> driver_time;
+	std::atomic<unsigned long long> sampled;
+	// The calls the sampled ones stand for
+	std::atomic<unsigned long long> calls;
+	std::atomic<long long> next_report;
+	Mutex *stack_lock;
+	// Waits before the log was opened are not ours to report
+	long long stack_wait_base;
+	long long mutex_wait_base;
+};
+
+#endif //#if !defined(ODBCOVERHEAD_H)
@@ -0,0 +1,436 @@
+#include "StdAfx.h"
+
+#include "ODBCPlatform.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+std::atomic<long long> Mutex::total_wait_time(0);
+
+#if defined(_WIN32)
+
+Mutex::Mutex() : wait_time(0)
+{
+	InitializeCriticalSection(&CriticalSection);
+}
+
+Mutex::~Mutex()
+{
+    DeleteCriticalSection(&CriticalSection);
+}
+
+void Mutex::enter()
+{
+	// Uncontended, as nearly always, it reads no clock
+	if (TryEnterCriticalSection(&CriticalSection))
+		return;
+	long long start = ODBCTraceNanoseconds();
+	EnterCriticalSection(&CriticalSection);
+	long long waited = ODBCTraceNanoseconds() - start;
+	wait_time.fetch_add(waited, std::memory_order_relaxed);
+	total_wait_time.fetch_add(waited, std::memory_order_relaxed);
+}
+
+void Mutex::leave()
+{
+    LeaveCriticalSection(&CriticalSection);
+}
+
+unsigned long ODBCProcessId()
+{
+	return GetCurrentProcessId();
+}
+
+unsigned long ODBCThreadId()
+{
+	return GetCurrentThreadId();
+}
+
+std::string ODBCExecutablePath()
+{
+	std::string cmdLine = GetCommandLine();
+	auto pos1 = cmdLine.find('\"');
+	if (pos1 >= 0)
+	{
+		auto pos2 = cmdLine.find('\"', pos1 + 1);
+		if (pos2 > 0)
+		{
+			cmdLine = cmdLine.substr(pos1 + 1, pos2);
+		}
+	}
+	pos1 = cmdLine.find('\/');
+	if (pos1 > 0)
+	{
+		cmdLine = cmdLine.substr(0, pos1);
+	}
+	return cmdLine;
+}
+
+std::string ODBCLocalTime()
+{
+	char logtime[64]; _strtime(logtime);
+	return logtime;
+}
+
+long long ODBCTraceNow()
+{
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart / frequency.QuadPart * 1000000 + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+
+long long ODBCTraceNanoseconds()
+{
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart / frequency.QuadPart * 1000000000 + counter.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart;
+}
+
+long long ODBCThreadCpuTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+	// 100 nanosecond units
+	unsigned long long total = (((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+		(((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime);
+	return (long long)(total / 10);
+}
+
+long long ODBCWallClockMilliseconds()
+{
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	unsigned long long ticks = ((unsigned long long)now.dwHighDateTime << 32) | now.dwLowDateTime;
+	return (long long)((ticks - 116444736000000000ULL) / 10000);
+}
+
+bool ODBCFileSync(FILE *file)
+{
+	return fflush(file) == 0 && _commit(_fileno(file)) == 0;
+}
+
+long long ODBCFileModified(const std::string &path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+		return -1;
+	return ((long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+bool ODBCSharedMemoryCreate(const std::string &name, size_t size, ODBCSharedMemory *memory)
+{
+	memory->mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, name.c_str());
+	if (memory->mapping == NULL)
+		return false;
+	memory->address = MapViewOfFile(memory->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (memory->address == NULL)
+	{
+		CloseHandle(memory->mapping);
+		memory->mapping = NULL;
+		return false;
+	}
+	memory->size = size;
+	return true;
+}
+
+void ODBCSharedMemoryRemoveStale(const std::string &prefix)
+{
+	// A mapping goes away with the last handle to it
+}
+
+bool ODBCPipeConnect(const std::string &endpoint, ODBCPipe *pipe, unsigned long timeout)
+{
+	// Fails with ERROR_PIPE_BUSY until the collector offers the next instance
+	pipe->handle = CreateFile(endpoint.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	if (pipe->handle == INVALID_HANDLE_VALUE)
+		return false;
+	pipe->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (pipe->event == NULL)
+	{
+		CloseHandle(pipe->handle);
+		pipe->handle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	pipe->timeout = timeout;
+	return true;
+}
+
+bool ODBCPipeWrite(ODBCPipe *pipe, const void *data, size_t size)
+{
+	const char *next = (const char*)data;
+	while (size > 0)
+	{
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+		overlapped.hEvent = pipe->event;
+		DWORD written;
+		if (!WriteFile(pipe->handle, next, (DWORD)size, NULL, &overlapped))
+		{
+			if (GetLastError() != ERROR_IO_PENDING)
+				return false;
+			if (WaitForSingleObject(pipe->event, pipe->timeout) != WAIT_OBJECT_0)
+			{
+				// The write must be over before its OVERLAPPED goes away
+				CancelIo(pipe->handle);
+				GetOverlappedResult(pipe->handle, &overlapped, &written, TRUE);
+				return false;
+			}
+		}
+		if (!GetOverlappedResult(pipe->handle, &overlapped, &written, FALSE))
+			return false;
+		next += written;
+		size -= written;
+	}
+	return true;
+}
+
+void ODBCPipeClose(ODBCPipe *pipe)
+{
+	CloseHandle(pipe->handle);
+	CloseHandle(pipe->event);
+	pipe->handle = INVALID_HANDLE_VALUE;
+	pipe->event = NULL;
+}
+
+#else
+
+// std::mutex is a futex on Linux, uncontended enter/leave stay in user space
+Mutex::Mutex() : wait_time(0)
+{
+}
+
+Mutex::~Mutex()
+{
+}
+
+void Mutex::enter()
+{
+	// Uncontended, as nearly always, it reads no clock
+	if (mutex.try_lock())
+		return;
+	long long start = ODBCTraceNanoseconds();
+	mutex.lock();
+	long long waited = ODBCTraceNanoseconds() - start;
+	wait_time.fetch_add(waited, std::memory_order_relaxed);
+	total_wait_time.fetch_add(waited, std::memory_order_relaxed);
+}
+
+void Mutex::leave()
+{
+	mutex.unlock();
+}
+
+unsigned long ODBCProcessId()
+{
+	return (unsigned long)getpid();
+}
+
+unsigned long ODBCThreadId()
+{
+#if defined(__linux__)
+	// The id tools like top and perf show, cached as it costs a syscall
+	static thread_local unsigned long id = (unsigned long)syscall(SYS_gettid);
+	return id;
+#else
+	return (unsigned long)(uintptr_t)pthread_self();
+#endif
+}
+
+std::string ODBCExecutablePath()
+{
+	// argv[0] is the first string of /proc/self/cmdline
+	std::string path;
+	FILE *file = fopen("/proc/self/cmdline", "r");
+	if (file)
+	{
+		int c;
+		while ((c = fgetc(file)) != EOF && c != 0)
+			path += (char)c;
+		fclose(file);
+	}
+	if (path.empty())
+	{
+		char link[4096];
+		ssize_t length = readlink("/proc/self/exe", link, sizeof(link) - 1);
+		if (length > 0)
+			path.assign(link, length);
+	}
+	return path;
+}
+
+std::string ODBCLocalTime()
+{
+	time_t now = time(NULL);
+	struct tm local;
+	char logtime[64];
+	localtime_r(&now, &local);
+	strftime(logtime, sizeof(logtime), "%H:%M:%S", &local);
+	return logtime;
+}
+
+long long ODBCTraceNow()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+long long ODBCTraceNanoseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+long long ODBCThreadCpuTime()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+long long ODBCWallClockMilliseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+bool ODBCFileSync(FILE *file)
+{
+	return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+long long ODBCFileModified(const std::string &path)
+{
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+		return -1;
+	return (long long)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+}
+
+bool ODBCSharedMemoryCreate(const std::string &name, size_t size, ODBCSharedMemory *memory)
+{
+	// The segment outlives the process, see ODBCSharedMemoryRemoveStale
+	memory->fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+	if (memory->fd < 0)
+		return false;
+	void *address = MAP_FAILED;
+	if (ftruncate(memory->fd, size) == 0)
+		address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory->fd, 0);
+	if (address == MAP_FAILED)
+	{
+		close(memory->fd);
+		shm_unlink(name.c_str());
+		memory->fd = -1;
+		return false;
+	}
+	memory->address = address;
+	memory->size = size;
+	return true;
+}
+
+void ODBCSharedMemoryRemoveStale(const std::string &prefix)
+{
+	// Listed in /dev/shm without the leading slash
+	std::string listed = prefix.substr(1);
+	DIR *directory = opendir("/dev/shm");
+	if (directory == NULL)
+		return;
+	for (struct dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory))
+	{
+		if (strncmp(entry->d_name, listed.c_str(), listed.size()) != 0)
+			continue;
+		pid_t pid = (pid_t)strtoul(entry->d_name + listed.size(), NULL, 10);
+		if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH)
+			shm_unlink((std::string("/") + entry->d_name).c_str());
+	}
+	closedir(directory);
+}
+
+bool ODBCPipeConnect(const std::string &endpoint, ODBCPipe *pipe, unsigned long timeout)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, endpoint.c_str(), sizeof(address.sun_path) - 1);
+
+	pipe->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (pipe->fd < 0)
+		return false;
+	// send fails with EAGAIN once it waited that long, as connect does
+	struct timeval limit;
+	limit.tv_sec = timeout / 1000;
+	limit.tv_usec = (timeout % 1000) * 1000;
+	setsockopt(pipe->fd, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+	if (connect(pipe->fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+	{
+		close(pipe->fd);
+		pipe->fd = -1;
+		return false;
+	}
+	return true;
+}
+
+bool ODBCPipeWrite(ODBCPipe *pipe, const void *data, size_t size)
+{
+#if defined(MSG_NOSIGNAL)
+	int flags = MSG_NOSIGNAL;
+#else
+	int flags = 0;
+#endif
+	const char *next = (const char*)data;
+	while (size > 0)
+	{
+		ssize_t written = send(pipe->fd, next, size, flags);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		next += written;
+		size -= written;
+	}
+	return true;
+}
+
+void ODBCPipeClose(ODBCPipe *pipe)
+{
+	close(pipe->fd);
+	pipe->fd = -1;
+}
+
+#endif
+
+MutexGuard::MutexGuard(Mutex *mutex) : mutex(mutex)
+{
+	mutex->enter();
+}
+
+MutexGuard::~MutexGuard()
+{
+	mutex->leave();
+}
@@ -0,0 +1,124 @@
+#if !defined(ODBCPLATFORM_H)
+#define ODBCPLATFORM_H
+
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#if !defined(_WIN32)
+#include <mutex>
+#endif
+
+// The few operating system services the tracer uses, implemented with Win32
+// on Windows and POSIX elsewhere so the library also builds for unixODBC.
+
+#if !defined(FAR)
+#define FAR
+#endif
+#if !defined(VOID)
+#define VOID void
+#endif
+#if !defined(TRACE_VERSION)
+#define TRACE_VERSION 1000
+#endif
+
+class Mutex
+{
+public:
+	Mutex();
+	~Mutex();
+	void enter();
+	void leave();
+	// Nanoseconds threads waited to enter this mutex, and any mutex
+	std::atomic<long long> wait_time;
+	static std::atomic<long long> total_wait_time;
+private:
+#if defined(_WIN32)
+	CRITICAL_SECTION CriticalSection;
+#else
+	std::mutex mutex;
+#endif
+};
+class MutexGuard
+{
+public:
+	MutexGuard(Mutex *mutex);
+	~MutexGuard();
+protected:
+	MutexGuard();
+	MutexGuard(const MutexGuard &);
+	MutexGuard & operator = (const MutexGuard &);
+	Mutex *mutex;
+};
+
+// A named shared memory segment, mapped read/write by its creator.
+struct ODBCSharedMemory
+{
+#if defined(_WIN32)
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+	void *address;
+	size_t size;
+};
+
+// Client end of a named pipe or Unix domain socket.
+struct ODBCPipe
+{
+#if defined(_WIN32)
+	HANDLE handle;
+	// Of the overlapped writes, which wait for the timeout at most
+	HANDLE event;
+	unsigned long timeout;
+#else
+	int fd;
+#endif
+};
+
+unsigned long ODBCProcessId();
+unsigned long ODBCThreadId();
+// Path of the executable as it was started, empty if it cannot be found.
+std::string ODBCExecutablePath();
+// Local time of day as HH:MM:SS.
+std::string ODBCLocalTime();
+// Monotonic time in microseconds.
+long long ODBCTraceNow();
+// Monotonic time in nanoseconds, for the tracer timing itself.
+long long ODBCTraceNanoseconds();
+// CPU time the calling thread used, user and kernel, in microseconds.
+long long ODBCThreadCpuTime();
+// Milliseconds since 1970-01-01 UTC.
+long long ODBCWallClockMilliseconds();
+// Writes the data of the file through to the disk.
+bool ODBCFileSync(FILE *file);
+// Time of the last write to a file, in units of the file system; -1 if the
+// file does not exist.
+long long ODBCFileModified(const std::string &path);
+bool ODBCSharedMemoryCreate(const std::string &name, size_t size, ODBCSharedMemory *memory);
+// Removes the segments named prefix followed by the id of a process that
+// has exited; POSIX segments outlive their process.
+void ODBCSharedMemoryRemoveStale(const std::string &prefix);
+// A write that cannot go on for timeout milliseconds, as the reader stopped
+// reading, fails.
+bool ODBCPipeConnect(const std::string &endpoint, ODBCPipe *pipe, unsigned long timeout);
+// Writes everything or fails, the pipe must be closed after a failure.
+bool ODBCPipeWrite(ODBCPipe *pipe, const void *data, size_t size);
+void ODBCPipeClose(ODBCPipe *pipe);
+
+// Converts a wide string to char one code unit at a time, which the tracer
+// has always done for the WCHAR entry points. The unit is wchar_t on Windows
+// but the 16 bit SQLWCHAR under unixODBC, where wchar_t is 32 bit.
+template <class T> std::string ODBCNarrow(const T *text, long length)
+{
+	if (text == NULL)
+		return "";
+	if (length < 0)
+		for (length = 0; text[length] != 0; length++);
+
+	std::string narrow(length, ' ');
+	for (long i = 0; i < length; i++)
+		narrow[i] = (char)text[i];
+	return narrow;
+}
+
+#endif //#if !defined(ODBCPLATFORM_H)
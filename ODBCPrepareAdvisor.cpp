@@ -0,0 +1,85 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCFingerprint.h"
+#include "ODBCPrepareAdvisor.h"
+
+ODBCPrepareEntry::ODBCPrepareEntry() : executions(0), total_time(0), new_executions(0), new_time(0),
+	repeated_executions(0), repeated_time(0), fastest(-1)
+{
+}
+
+ODBCPrepareAdvisor* ODBCPrepareAdvisor::inst;
+ODBCPrepareAdvisor* ODBCPrepareAdvisor::get()
+{
+	if (inst == NULL)
+		inst = new ODBCPrepareAdvisor();
+	return inst;
+}
+
+ODBCPrepareAdvisor::ODBCPrepareAdvisor() : fingerprints(ODBCPREPARE_TRACKED)
+{
+}
+
+void ODBCPrepareAdvisor::executed(const ODBCFingerprint &fingerprint, const std::string &statement, long long elapsed)
+{
+	unsigned long long text = ODBCFingerprintHash(statement.data(), statement.size());
+
+	MutexGuard guard(&lock);
+	auto it = fingerprints.find(fingerprint.hash);
+	if (it == fingerprints.end())
+	{
+		it = fingerprints.insert(fingerprint.hash, ODBCPrepareEntry());
+		it->second.text = fingerprint.text;
+	}
+
+	ODBCPrepareEntry *entry = &it->second;
+	entry->executions++;
+	entry->total_time += elapsed;
+	if (entry->fastest < 0 || elapsed < entry->fastest)
+		entry->fastest = elapsed;
+	if (entry->texts.count(text) != 0)
+	{
+		entry->repeated_executions++;
+		entry->repeated_time += elapsed;
+		return;
+	}
+	if (entry->texts.size() < ODBCPREPARE_TEXTS)
+		entry->texts.insert(text);
+	entry->new_executions++;
+	entry->new_time += elapsed;
+}
+
+static bool compareTotalTime(const ODBCPrepareEntry *a, const ODBCPrepareEntry *b)
+{
+	return a->total_time > b->total_time;
+}
+
+void ODBCPrepareAdvisor::report()
+{
+	MutexGuard guard(&lock);
+	std::vector<const ODBCPrepareEntry*> candidates;
+	for (auto it = fingerprints.begin(); it != fingerprints.end(); ++it)
+		if (it->second.new_executions >= ODBCPREPARE_MINEXECUTIONS && it->second.texts.size() > 1)
+			candidates.push_back(&it->second);
+	std::sort(candidates.begin(), candidates.end(), compareTotalTime);
+
+	std::string prefix = std::to_string(ODBCProcessId()) + " prepare ";
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		const ODBCPrepareEntry *entry = candidates[i];
+		// Prepared once, only the first execution would still be parsed
+		long long parsed = entry->new_executions - 1;
+		std::string saved;
+		if (entry->repeated_executions >= ODBCPREPARE_MINREPEATS)
+		{
+			long long parse = entry->new_time / (long long)entry->new_executions - entry->repeated_time / (long long)entry->repeated_executions;
+			saved = ODBCFormatNumber(std::max(parse, 0LL) * parsed / 1000) + "ms Parse ";
+		}
+		else
+			saved = "up to " + ODBCFormatNumber(entry->fastest * parsed / 1000) + "ms Parse ";
+		ODBCWriteLog(prefix + ODBCFormatNumber(entry->executions) + " Executions " + ODBCFormatNumber(entry->texts.size()) + " Texts " +
+			ODBCFormatNumber(entry->total_time / 1000) + "ms ExecDirect " + saved + entry->text);
+	}
+	fingerprints.clear();
+}
@@ -0,0 +1,61 @@
+#if !defined(ODBCPREPAREADVISOR_H)
+#define ODBCPREPAREADVISOR_H
+
+#include <set>
+#include "ODBCRecentMap.h"
+
+// Executions with differing literals after which a fingerprint is reported.
+#define ODBCPREPARE_MINEXECUTIONS 10
+// Executions repeating a literal text before their time is trusted as that
+// of an execution whose plan the server had cached.
+#define ODBCPREPARE_MINREPEATS 5
+// Fingerprints followed, the one executed least recently makes room for a
+// new one, and distinct texts remembered per fingerprint; a text beyond
+// those counts as new.
+#define ODBCPREPARE_TRACKED 1024
+#define ODBCPREPARE_TEXTS 1024
+
+struct ODBCPrepareEntry
+{
+	ODBCPrepareEntry();
+	std::string text;
+	std::set<unsigned long long> texts;
+	unsigned long long executions;
+	long long total_time;
+	// Executions with a text not seen before, which the server has to parse
+	// and plan, and those repeating one, whose plan it may have cached
+	unsigned long long new_executions;
+	long long new_time;
+	unsigned long long repeated_executions;
+	long long repeated_time;
+	long long fastest;
+};
+
+// Finds statements an application runs with SQLExecDirect over and over
+// with literal values spliced in, which makes the server parse and plan
+// every one of them where SQLPrepare with parameters would do so once. The
+// time of the SQLExecDirect calls of each fingerprint is kept apart for new
+// and repeated literal texts; their difference per execution estimates the
+// parse and plan cost. Without enough repeated texts to compare against,
+// the fastest execution bounds it from above and the estimate is reported
+// as "up to". Fingerprints executed with at least ODBCPREPARE_MINEXECUTIONS
+// and more than one text are reported by total time when the log is closed:
+// "<pid> prepare N Executions M Texts Xms ExecDirect [up to] Yms Parse <text>".
+class ODBCPrepareAdvisor
+{
+private:
+	static ODBCPrepareAdvisor* inst;
+
+public:
+	static ODBCPrepareAdvisor* get();
+	ODBCPrepareAdvisor();
+	// A SQLExecDirect of the statement returned after that many microseconds.
+	void executed(const ODBCFingerprint &fingerprint, const std::string &statement, long long elapsed);
+	void report();
+
+private:
+	Mutex lock;
+	ODBCRecentMap<ODBCPrepareEntry> fingerprints;
+};
+
+#endif //#if !defined(ODBCPREPAREADVISOR_H)
@@ -0,0 +1,67 @@
+#if !defined(ODBCRECENTMAP_H)
+#define ODBCRECENTMAP_H
+
+#include <list>
+#include <map>
+
+// Entries keyed by a hash, at most a fixed number of them: once the map is
+// full a new key takes the place of the one used least recently, so keys
+// that turn up late in a long running process are followed as well. The
+// entries are kept in the order of their last use, least recent first, and
+// iterate like those of a std::map. Not synchronized, the owner locks.
+template <class T> class ODBCRecentMap
+{
+public:
+	typedef std::list<std::pair<unsigned long long, T> > Entries;
+	typedef typename Entries::iterator iterator;
+
+	ODBCRecentMap(size_t limit) : limit(limit)
+	{
+	}
+
+	// The entry of the key, now the most recently used; end() if there is
+	// none.
+	iterator find(unsigned long long key)
+	{
+		typename std::map<unsigned long long, iterator>::iterator it = index.find(key);
+		if (it == index.end())
+			return entries.end();
+		entries.splice(entries.end(), entries, it->second);
+		return it->second;
+	}
+
+	// Adds the entry of a key not in the map, dropping the least recently
+	// used entry when the map is full.
+	iterator insert(unsigned long long key, const T &value)
+	{
+		if (full())
+			erase(entries.begin());
+		iterator it = entries.insert(entries.end(), std::make_pair(key, value));
+		index[key] = it;
+		return it;
+	}
+
+	void erase(iterator it)
+	{
+		index.erase(it->first);
+		entries.erase(it);
+	}
+
+	bool full() const { return index.size() >= limit; }
+	size_t size() const { return index.size(); }
+	iterator begin() { return entries.begin(); }
+	iterator end() { return entries.end(); }
+
+	void clear()
+	{
+		index.clear();
+		entries.clear();
+	}
+
+private:
+	size_t limit;
+	Entries entries;
+	std::map<unsigned long long, iterator> index;
+};
+
+#endif //#if !defined(ODBCRECENTMAP_H)
@@ -0,0 +1,91 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCFingerprint.h"
+#include "ODBCRepeatDetector.h"
+
+ODBCRepeatEntry::ODBCRepeatEntry() : executions(0), total_time(0), repeats(0), repeated_time(0), repeated_gap(0),
+	last_end(0), last_records(0)
+{
+}
+
+ODBCRepeatDetector* ODBCRepeatDetector::inst;
+ODBCRepeatDetector* ODBCRepeatDetector::get()
+{
+	if (inst == NULL)
+		inst = new ODBCRepeatDetector();
+	return inst;
+}
+
+ODBCRepeatDetector::ODBCRepeatDetector() : statements(ODBCREPEAT_TRACKED)
+{
+}
+
+void ODBCRepeatDetector::statement(const std::string &statement, long long begin_time, long long end_time, long long records, long long window)
+{
+	unsigned long long hash = ODBCFingerprintHash(statement.data(), statement.size());
+
+	MutexGuard guard(&lock);
+	auto it = statements.find(hash);
+	// Another text with the same hash takes the place of the one followed
+	if (it != statements.end() && it->second.text != statement)
+	{
+		evict(it);
+		it = statements.end();
+	}
+	if (it == statements.end())
+	{
+		if (statements.full())
+			evict(statements.begin());
+		it = statements.insert(hash, ODBCRepeatEntry());
+		it->second.text = statement;
+	}
+
+	ODBCRepeatEntry *entry = &it->second;
+	if (entry->executions > 0 && records == entry->last_records &&
+		begin_time >= entry->last_end && begin_time - entry->last_end <= window)
+	{
+		entry->repeats++;
+		entry->repeated_time += end_time - begin_time;
+		entry->repeated_gap += begin_time - entry->last_end;
+	}
+	entry->executions++;
+	entry->total_time += end_time - begin_time;
+	entry->last_end = end_time;
+	entry->last_records = records;
+}
+
+// Called with the lock held.
+void ODBCRepeatDetector::evict(ODBCRecentMap<ODBCRepeatEntry>::iterator it)
+{
+	if (it->second.repeats >= ODBCREPEAT_MINREPEATS)
+		write(&it->second);
+	statements.erase(it);
+}
+
+void ODBCRepeatDetector::write(const ODBCRepeatEntry *entry)
+{
+	ODBCWriteLog(std::to_string(ODBCProcessId()) + " repeat " + ODBCFormatNumber(entry->executions) + " Executions " + ODBCFormatNumber(entry->repeats) + " Repeats " +
+		ODBCFormatNumber(entry->total_time / 1000) + "ms Total " + ODBCFormatNumber(entry->repeated_time / 1000) + "ms Repeated " +
+		ODBCFormatNumber(entry->last_records) + " Recs " + ODBCFormatNumber(entry->repeated_gap / (long long)entry->repeats / 1000) + "ms Interval " +
+		std::regex_replace(entry->text, std::regex("\\r\\n|\\r|\\n"), " "));
+}
+
+static bool compareTotalTime(const ODBCRepeatEntry *a, const ODBCRepeatEntry *b)
+{
+	return a->total_time > b->total_time;
+}
+
+void ODBCRepeatDetector::report()
+{
+	MutexGuard guard(&lock);
+	std::vector<const ODBCRepeatEntry*> candidates;
+	for (auto it = statements.begin(); it != statements.end(); ++it)
+		if (it->second.repeats >= ODBCREPEAT_MINREPEATS)
+			candidates.push_back(&it->second);
+	std::sort(candidates.begin(), candidates.end(), compareTotalTime);
+
+	for (size_t i = 0; i < candidates.size(); i++)
+		write(candidates[i]);
+	statements.clear();
+}
@@ -0,0 +1,60 @@
+#if !defined(ODBCREPEATDETECTOR_H)
+#define ODBCREPEATDETECTOR_H
+
+#include "ODBCRecentMap.h"
+
+// Seconds within which a statement run again counts as a repeat.
+#define ODBCREPEAT_WINDOW 60
+// Repeats after which a statement is reported.
+#define ODBCREPEAT_MINREPEATS 3
+// Statement texts followed at once.
+#define ODBCREPEAT_TRACKED 1024
+
+struct ODBCRepeatEntry
+{
+	ODBCRepeatEntry();
+	std::string text;
+	unsigned long long executions;
+	long long total_time;
+	// Executions within the window of the previous one with the same number
+	// of records, the time a cache of the result would have saved, and the
+	// microseconds between them
+	unsigned long long repeats;
+	long long repeated_time;
+	long long repeated_gap;
+	long long last_end;
+	long long last_records;
+};
+
+// Finds statements run again and again with exactly the same text that keep
+// returning the same number of records, as dashboards polling a query do,
+// whose results the application could cache. Statements are told apart by
+// the hash of their whole text, literals included; a statement closed
+// successfully is a repeat when it started within the "repeat_window" of
+// ODBCConfig after the previous one ended and fetched as many records. The
+// table of texts is bounded by ODBCREPEAT_TRACKED, the text run least
+// recently makes room for a new one. Statements repeated at least
+// ODBCREPEAT_MINREPEATS times are reported when they make room, or by total
+// time when the log is closed:
+// "<pid> repeat N Executions R Repeats Xms Total Yms Repeated Z Recs Gms Interval <text>".
+// Without record counting every count is 0 and only the window is compared.
+class ODBCRepeatDetector
+{
+private:
+	static ODBCRepeatDetector* inst;
+
+public:
+	static ODBCRepeatDetector* get();
+	ODBCRepeatDetector();
+	void statement(const std::string &statement, long long begin_time, long long end_time, long long records, long long window);
+	void report();
+
+private:
+	void evict(ODBCRecentMap<ODBCRepeatEntry>::iterator it);
+	static void write(const ODBCRepeatEntry *entry);
+
+	Mutex lock;
+	ODBCRecentMap<ODBCRepeatEntry> statements;
+};
+
+#endif //#if !defined(ODBCREPEATDETECTOR_H)
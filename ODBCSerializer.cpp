@@ -0,0 +1,221 @@
+#include "StdAfx.h"
+
+#include "ODBCSerializer.h"
+
+static const char hex_digits[] = "0123456789abcdef";
+
+ODBCSerializer::ODBCSerializer(ODBCOutputFormat format, std::string *line) : format(format), line(line), first(true)
+{
+	if (format == OUTPUT_JSON)
+		line->push_back('{');
+}
+
+void ODBCSerializer::separate(const char *name)
+{
+	if (!first)
+		line->push_back(',');
+	first = false;
+	if (format == OUTPUT_JSON)
+	{
+		line->push_back('"');
+		line->append(name);
+		line->append("\":", 2);
+	}
+}
+
+void ODBCSerializer::number(const char *name, long long value)
+{
+	separate(name);
+	char digits[24];
+	char *end = digits + sizeof(digits);
+	char *begin = end;
+	unsigned long long magnitude = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+	do
+	{
+		*--begin = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+	if (value < 0)
+		*--begin = '-';
+	line->append(begin, end - begin);
+}
+
+// Handles and fingerprints as 0x... text, JSON numbers lose 64 bit values.
+void ODBCSerializer::hex(const char *name, unsigned long long value)
+{
+	separate(name);
+	char digits[20];
+	char *end = digits + sizeof(digits);
+	char *begin = end;
+	do
+	{
+		*--begin = hex_digits[value & 0xf];
+		value >>= 4;
+	} while (value > 0);
+	*--begin = 'x';
+	*--begin = '0';
+	if (format == OUTPUT_JSON)
+		line->push_back('"');
+	line->append(begin, end - begin);
+	if (format == OUTPUT_JSON)
+		line->push_back('"');
+}
+
+void ODBCSerializer::text(const char *name, const char *value, size_t length)
+{
+	separate(name);
+	if (format == OUTPUT_JSON)
+		escapeJson(value, length);
+	else
+		escapeCsv(value, length);
+}
+
+void ODBCSerializer::text(const char *name, const std::string &value)
+{
+	text(name, value.data(), value.size());
+}
+
+void ODBCSerializer::null(const char *name)
+{
+	if (format == OUTPUT_JSON)
+		return;
+	separate(name);
+}
+
+void ODBCSerializer::object(const char *name)
+{
+	separate(name);
+	line->push_back('{');
+	first = true;
+}
+
+void ODBCSerializer::array(const char *name)
+{
+	separate(name);
+	line->push_back('[');
+	first = true;
+}
+
+void ODBCSerializer::item()
+{
+	if (!first)
+		line->push_back(',');
+	line->push_back('{');
+	first = true;
+}
+
+void ODBCSerializer::endArray()
+{
+	line->push_back(']');
+	first = false;
+}
+
+void ODBCSerializer::end()
+{
+	if (format == OUTPUT_JSON)
+		line->push_back('}');
+	first = false;
+}
+
+// Bytes of the well formed UTF-8 sequence starting at text, 0 if there is
+// none: overlong forms, surrogates and code points above U+10FFFF are not.
+static size_t utf8Sequence(const unsigned char *text, size_t length)
+{
+	size_t size;
+	unsigned char low = 0x80, high = 0xbf;
+	if (text[0] >= 0xc2 && text[0] <= 0xdf)
+		size = 2;
+	else if (text[0] >= 0xe0 && text[0] <= 0xef)
+	{
+		size = 3;
+		if (text[0] == 0xe0)
+			low = 0xa0;
+		else if (text[0] == 0xed)
+			high = 0x9f;
+	}
+	else if (text[0] >= 0xf0 && text[0] <= 0xf4)
+	{
+		size = 4;
+		if (text[0] == 0xf0)
+			low = 0x90;
+		else if (text[0] == 0xf4)
+			high = 0x8f;
+	}
+	else
+		return 0;
+	if (size > length || text[1] < low || text[1] > high)
+		return 0;
+	for (size_t i = 2; i < size; i++)
+		if (text[i] < 0x80 || text[i] > 0xbf)
+			return 0;
+	return size;
+}
+
+// UTF-8 text passes unchanged. A byte that is not part of a well formed
+// sequence, as text in a legacy code page has, is written as the code point
+// of the same value, which keeps the line valid JSON.
+void ODBCSerializer::escapeJson(const char *value, size_t length)
+{
+	line->push_back('"');
+	size_t plain = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		unsigned char c = (unsigned char)value[i];
+		if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+			continue;
+		if (c >= 0x80)
+		{
+			size_t size = utf8Sequence((const unsigned char*)value + i, length - i);
+			if (size > 0)
+			{
+				i += size - 1;
+				continue;
+			}
+		}
+
+		line->append(value + plain, i - plain);
+		plain = i + 1;
+		switch (c)
+		{
+		case '"': line->append("\\\"", 2); break;
+		case '\\': line->append("\\\\", 2); break;
+		case '\n': line->append("\\n", 2); break;
+		case '\r': line->append("\\r", 2); break;
+		case '\t': line->append("\\t", 2); break;
+		default:
+		{
+			char escape[6] = { '\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0xf] };
+			line->append(escape, sizeof(escape));
+		}
+		}
+	}
+	line->append(value + plain, length - plain);
+	line->push_back('"');
+}
+
+// Quoted only when needed, quotes inside are doubled. Line breaks stay in
+// the quoted field, as RFC 4180 allows.
+void ODBCSerializer::escapeCsv(const char *value, size_t length)
+{
+	bool quote = false;
+	for (size_t i = 0; i < length && !quote; i++)
+		quote = value[i] == ',' || value[i] == '"' || value[i] == '\r' || value[i] == '\n';
+	if (!quote)
+	{
+		line->append(value, length);
+		return;
+	}
+
+	line->push_back('"');
+	size_t plain = 0;
+	for (size_t i = 0; i < length; i++)
+	{
+		if (value[i] != '"')
+			continue;
+		line->append(value + plain, i + 1 - plain);
+		line->push_back('"');
+		plain = i + 1;
+	}
+	line->append(value + plain, length - plain);
+	line->push_back('"');
+}
@@ -0,0 +1,50 @@
+#if !defined(ODBCSERIALIZER_H)
+#define ODBCSERIALIZER_H
+
+#include <string>
+
+// Format of the log lines, selected by the log file name: "_json" writes JSON
+// Lines, "_csv" RFC 4180 CSV with a header, anything else the text lines.
+enum ODBCOutputFormat
+{
+	OUTPUT_TEXT,
+	OUTPUT_JSON,
+	OUTPUT_CSV
+};
+
+// Appends the fields of one record to a line, escaping them for the format.
+// Every record has the fields of ODBCCSV_HEADER in that order; a JSON record
+// leaves out the fields passed as null, a CSV record leaves them empty.
+// Numbers and escapes are written straight into the line, which the caller
+// reuses, so a record costs no allocation once the line has grown.
+class ODBCSerializer
+{
+public:
+	ODBCSerializer(ODBCOutputFormat format, std::string *line);
+	void number(const char *name, long long value);
+	void hex(const char *name, unsigned long long value);
+	void text(const char *name, const char *value, size_t length);
+	void text(const char *name, const std::string &value);
+	void null(const char *name);
+	// Starts a nested JSON object, end() closes it.
+	void object(const char *name);
+	// Starts a JSON array of objects: item() starts each object, end() closes
+	// it and endArray() the array.
+	void array(const char *name);
+	void item();
+	void endArray();
+	void end();
+
+private:
+	void separate(const char *name);
+	void escapeJson(const char *value, size_t length);
+	void escapeCsv(const char *value, size_t length);
+
+	ODBCOutputFormat format;
+	std::string *line;
+	bool first;
+};
+
+#define ODBCCSV_HEADER "time,process,pid,type,connection,statement,begin_us,elapsed_us,rows,retcode,fingerprint,text"
+
+#endif //#if !defined(ODBCSERIALIZER_H)
@@ -0,0 +1,302 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCHandles.h"
+#include "ODBCSpanExporter.h"
+
+// OTLP span kinds
+#define SPAN_KIND_INTERNAL 1
+#define SPAN_KIND_CLIENT 3
+// OTLP status code of a failed span
+#define STATUS_CODE_ERROR 2
+
+ODBCSpanExporter* ODBCSpanExporter::inst;
+ODBCSpanExporter* ODBCSpanExporter::get()
+{
+	if (inst == NULL)
+		inst = new ODBCSpanExporter();
+	return inst;
+}
+
+ODBCSpanExporter::ODBCSpanExporter() : active(false), ids(0), epoch_offset(0), file(NULL)
+{
+}
+
+void ODBCSpanExporter::open(const std::string &logfile)
+{
+	close();
+
+	MutexGuard guard(&lock);
+	file = fopen(ODBCProcessFile(logfile, ".otlp.json").c_str(), "a");
+	if (!file)
+		return;
+	epoch_offset = ODBCWallClockMilliseconds() * 1000 - ODBCTraceNow();
+	ids = (unsigned long long)ODBCWallClockMilliseconds() * 1000003 ^ (unsigned long long)ODBCProcessId() << 32 ^ (unsigned long long)ODBCTraceNow();
+	batch.reserve(ODBCSPANEXPORTER_BATCH);
+	active = true;
+}
+
+void ODBCSpanExporter::close()
+{
+	if (!active.exchange(false))
+		return;
+
+	std::vector<ODBCSpan*> spans;
+	{
+		MutexGuard guard(&lock);
+		spans.swap(batch);
+	}
+	exportBatch(spans);
+
+	MutexGuard guard(&lock);
+	fclose(file);
+	file = NULL;
+}
+
+// splitmix64, ids only need to be unique, not unpredictable
+unsigned long long ODBCSpanExporter::nextId()
+{
+	unsigned long long id = ids.fetch_add(0x9e3779b97f4a7c15ULL) + 0x9e3779b97f4a7c15ULL;
+	id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	id = (id ^ (id >> 27)) * 0x94d049bb133111ebULL;
+	id ^= id >> 31;
+	return id == 0 ? 1 : id;
+}
+
+ODBCSpan* ODBCSpanExporter::acquire(ODBCSpanKind kind, ODBCSpan *parent, long long begin_time)
+{
+	ODBCSpan *span;
+	{
+		MutexGuard guard(&lock);
+		if (pool.empty())
+			span = new ODBCSpan();
+		else
+		{
+			span = pool.back();
+			pool.pop_back();
+		}
+	}
+
+	span->kind = kind;
+	span->trace_high = parent ? parent->trace_high : nextId();
+	span->trace_low = parent ? parent->trace_low : nextId();
+	span->id = nextId();
+	span->parent = parent ? parent->id : 0;
+	span->name.clear();
+	span->begin_time = begin_time;
+	span->end_time = begin_time;
+	span->handle = NULL;
+	span->fingerprint = 0;
+	span->rows = 0;
+	span->bytes = 0;
+	span->retcode = 0;
+	span->failed = false;
+	span->statements = 0;
+	return span;
+}
+
+ODBCSpan* ODBCSpanExporter::connectionSpan(ODBCConnectionState *connection)
+{
+	if (connection->span == NULL)
+	{
+		connection->span = acquire(SPAN_CONNECTION, NULL, connection->begin_time);
+		connection->span->name = "connection";
+		connection->span->handle = connection->hdbc;
+	}
+	return connection->span;
+}
+
+// Queues a span for the next batch. The thread filling the batch exports
+// it, the others only take the lock for the queue.
+void ODBCSpanExporter::finish(ODBCSpan *span, long long end_time)
+{
+	static thread_local std::vector<ODBCSpan*> spans;
+	span->end_time = end_time;
+	{
+		MutexGuard guard(&lock);
+		if (!active)
+		{
+			pool.push_back(span);
+			return;
+		}
+		batch.push_back(span);
+		if (batch.size() < ODBCSPANEXPORTER_BATCH)
+			return;
+		spans.swap(batch);
+		batch.reserve(ODBCSPANEXPORTER_BATCH);
+	}
+	exportBatch(spans);
+}
+
+static void stringAttribute(ODBCSerializer *attributes, const char *key, const char *value, size_t length)
+{
+	attributes->item();
+	attributes->text("key", key, strlen(key));
+	attributes->object("value");
+	attributes->text("stringValue", value, length);
+	attributes->end();
+	attributes->end();
+}
+
+static void hexAttribute(ODBCSerializer *attributes, const char *key, unsigned long long value)
+{
+	attributes->item();
+	attributes->text("key", key, strlen(key));
+	attributes->object("value");
+	attributes->hex("stringValue", value);
+	attributes->end();
+	attributes->end();
+}
+
+// 64 bit integers are strings in OTLP/JSON
+static void intAttribute(ODBCSerializer *attributes, const char *key, long long value)
+{
+	char digits[24];
+	int length = sprintf(digits, "%lld", value);
+	attributes->item();
+	attributes->text("key", key, strlen(key));
+	attributes->object("value");
+	attributes->text("intValue", digits, length);
+	attributes->end();
+	attributes->end();
+}
+
+void ODBCSpanExporter::serialize(ODBCSpan *span, ODBCSerializer *request)
+{
+	char id[40];
+	request->item();
+	sprintf(id, "%016llx%016llx", span->trace_high, span->trace_low);
+	request->text("traceId", id, 32);
+	sprintf(id, "%016llx", span->id);
+	request->text("spanId", id, 16);
+	if (span->parent != 0)
+	{
+		sprintf(id, "%016llx", span->parent);
+		request->text("parentSpanId", id, 16);
+	}
+	request->text("name", span->name);
+	request->number("kind", span->kind == SPAN_STATEMENT ? SPAN_KIND_CLIENT : SPAN_KIND_INTERNAL);
+	int length = sprintf(id, "%lld", (span->begin_time + epoch_offset) * 1000);
+	request->text("startTimeUnixNano", id, length);
+	length = sprintf(id, "%lld", (span->end_time + epoch_offset) * 1000);
+	request->text("endTimeUnixNano", id, length);
+
+	request->array("attributes");
+	if (span->kind == SPAN_STATEMENT)
+	{
+		stringAttribute(request, "db.system", "odbc", 4);
+		hexAttribute(request, "odbc.hstmt", (uintptr_t)span->handle);
+		hexAttribute(request, "odbc.fingerprint", span->fingerprint);
+		intAttribute(request, "db.response.returned_rows", span->rows);
+		intAttribute(request, "odbc.bytes", span->bytes);
+		intAttribute(request, "odbc.retcode", span->retcode);
+	}
+	else
+	{
+		if (span->kind == SPAN_CONNECTION)
+			hexAttribute(request, "odbc.hdbc", (uintptr_t)span->handle);
+		intAttribute(request, "odbc.statements", span->statements);
+	}
+	request->endArray();
+
+	if (span->failed)
+	{
+		request->object("status");
+		request->number("code", STATUS_CODE_ERROR);
+		request->end();
+	}
+	request->end();
+}
+
+// Writes the spans as one ExportTraceServiceRequest line and returns them to
+// the pool.
+void ODBCSpanExporter::exportBatch(std::vector<ODBCSpan*> &spans)
+{
+	static thread_local std::string line;
+	if (spans.empty())
+		return;
+
+	line.clear();
+	ODBCSerializer request(OUTPUT_JSON, &line);
+	request.array("resourceSpans");
+	request.item();
+	request.object("resource");
+	request.array("attributes");
+	stringAttribute(&request, "service.name", ODBCProcessName().data(), ODBCProcessName().size());
+	intAttribute(&request, "process.pid", ODBCProcessId());
+	request.endArray();
+	request.end();
+	request.array("scopeSpans");
+	request.item();
+	request.object("scope");
+	request.text("name", "ODBCTracer", 10);
+	request.end();
+	request.array("spans");
+	for (size_t i = 0; i < spans.size(); i++)
+		serialize(spans[i], &request);
+	request.endArray();
+	request.end();
+	request.endArray();
+	request.end();
+	request.endArray();
+	request.end();
+	line.push_back('\n');
+
+	MutexGuard guard(&lock);
+	if (file)
+	{
+		fwrite(line.data(), 1, line.size(), file);
+		fflush(file);
+	}
+	pool.insert(pool.end(), spans.begin(), spans.end());
+	spans.clear();
+}
+
+void ODBCSpanExporter::statement(ODBCConnectionState *connection, ODBCStatementState *stmt, long long end_time)
+{
+	if (!active)
+		return;
+
+	ODBCSpan *parent = connectionSpan(connection);
+	parent->statements++;
+	if (!connection->autocommit)
+	{
+		if (connection->transaction == NULL)
+			connection->transaction = acquire(SPAN_TRANSACTION, parent, stmt->begin_time);
+		parent = connection->transaction;
+		parent->statements++;
+	}
+
+	ODBCSpan *span = acquire(SPAN_STATEMENT, parent, stmt->begin_time);
+	const ODBCFingerprint &fingerprint = stmt->fingerprint();
+	span->name.assign(fingerprint.text);
+	span->handle = stmt->hstmt;
+	span->fingerprint = fingerprint.hash;
+	span->rows = stmt->record_count;
+	span->bytes = stmt->bytes;
+	span->retcode = stmt->retcode;
+	span->failed = stmt->failed;
+	finish(span, end_time);
+}
+
+void ODBCSpanExporter::transactionEnded(ODBCConnectionState *connection, const char *completion, long long end_time)
+{
+	if (connection->transaction == NULL)
+		return;
+	connection->transaction->name = completion;
+	finish(connection->transaction, end_time);
+	connection->transaction = NULL;
+}
+
+void ODBCSpanExporter::connectionClosed(ODBCConnectionState *connection, long long end_time)
+{
+	MutexGuard guard(&connection->lock);
+	// Disconnected without ending the transaction, the driver decides
+	transactionEnded(connection, "transaction", end_time);
+	if (connection->span == NULL)
+		return;
+	finish(connection->span, end_time);
+	connection->span = NULL;
+}
@@ -0,0 +1,85 @@
+#if !defined(ODBCSPANEXPORTER_H)
+#define ODBCSPANEXPORTER_H
+
+#include <atomic>
+
+struct ODBCConnectionState;
+struct ODBCStatementState;
+
+// Spans collected before they are exported together as one request.
+#define ODBCSPANEXPORTER_BATCH 512
+
+enum ODBCSpanKind
+{
+	SPAN_CONNECTION,
+	SPAN_TRANSACTION,
+	SPAN_STATEMENT
+};
+
+// One span of the export. Spans are taken from a pool and go back to it once
+// they are written, so their name keeps its capacity and a span costs no
+// allocation after the first batches.
+struct ODBCSpan
+{
+	ODBCSpanKind kind;
+	unsigned long long trace_high;
+	unsigned long long trace_low;
+	unsigned long long id;
+	// 0 for the connection span
+	unsigned long long parent;
+	std::string name;
+	long long begin_time;
+	long long end_time;
+	const void *handle;
+	// Statements only
+	unsigned long long fingerprint;
+	long long rows;
+	long long bytes;
+	int retcode;
+	bool failed;
+	// Connections and transactions only
+	long long statements;
+};
+
+// Exports the statements as OpenTelemetry spans when the log file name
+// contains "_otlp". Each connection is a trace: its span lasts from the first
+// call the tracer sees until SQLDisconnect, the statements are its children.
+// With autocommit off a transaction span from the first statement until
+// SQLEndTran sits in between. Each process appends to
+// <log file>.<pid>.otlp.json, one OTLP/JSON ExportTraceServiceRequest per
+// line, which the otlpjsonfile receiver of the OpenTelemetry Collector reads.
+class ODBCSpanExporter
+{
+private:
+	static ODBCSpanExporter* inst;
+
+public:
+	static ODBCSpanExporter* get();
+	ODBCSpanExporter();
+	void open(const std::string &logfile);
+	void close();
+	// The caller holds the lock of the connection.
+	void statement(ODBCConnectionState *connection, ODBCStatementState *stmt, long long end_time);
+	void transactionEnded(ODBCConnectionState *connection, const char *completion, long long end_time);
+	// The connection is released, its spans end.
+	void connectionClosed(ODBCConnectionState *connection, long long end_time);
+
+private:
+	ODBCSpan* acquire(ODBCSpanKind kind, ODBCSpan *parent, long long begin_time);
+	ODBCSpan* connectionSpan(ODBCConnectionState *connection);
+	void finish(ODBCSpan *span, long long end_time);
+	void exportBatch(std::vector<ODBCSpan*> &spans);
+	void serialize(ODBCSpan *span, ODBCSerializer *request);
+	unsigned long long nextId();
+
+	std::atomic<bool> active;
+	std::atomic<unsigned long long> ids;
+	// Microseconds to add to ODBCTraceNow for the time since 1970
+	long long epoch_offset;
+	Mutex lock;
+	FILE* file;
+	std::vector<ODBCSpan*> pool;
+	std::vector<ODBCSpan*> batch;
+};
+
+#endif //#if !defined(ODBCSPANEXPORTER_H)
@@ -0,0 +1,146 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCStatementFilter.h"
+
+#include <ctype.h>
+
+static std::string filterLower(const std::string &text)
+{
+	std::string lower = text;
+	std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+	return lower;
+}
+
+ODBCStatementFilter::ODBCStatementFilter() : includes(false), sql_excludes(false), process_match(0)
+{
+}
+
+bool ODBCStatementFilter::add(bool include, const std::string &rule)
+{
+	size_t colon = rule.find(':');
+	if (colon == std::string::npos || colon + 1 == rule.size())
+		return false;
+	std::string kind = rule.substr(0, colon);
+	Rule added = { include ? MATCH_INCLUDE : MATCH_EXCLUDE, filterLower(rule.substr(colon + 1)) };
+	if (kind == "sql")
+		sql.push_back(added);
+	else if (kind == "dsn")
+		dsn.push_back(added);
+	else if (kind == "process")
+		process.push_back(added);
+	else
+		return false;
+	if (include)
+		includes = true;
+	else if (kind == "sql")
+		sql_excludes = true;
+	return true;
+}
+
+void ODBCStatementFilter::compile()
+{
+	for (size_t i = 0; i < process.size(); i++)
+		if (process[i].text == ODBCProcessName())
+			process_match |= process[i].match;
+
+	transitions.clear();
+	matches.clear();
+	if (sql.empty())
+		return;
+
+	// The trie of the texts, -1 where it has no transition
+	transitions.assign(256, -1);
+	matches.assign(1, 0);
+	for (size_t i = 0; i < sql.size(); i++)
+	{
+		int state = 0;
+		for (size_t j = 0; j < sql[i].text.size(); j++)
+		{
+			size_t next = state * 256 + (unsigned char)sql[i].text[j];
+			if (transitions[next] < 0)
+			{
+				transitions[next] = (int)matches.size();
+				matches.push_back(0);
+				transitions.resize(transitions.size() + 256, -1);
+			}
+			state = transitions[next];
+		}
+		matches[state] |= sql[i].match;
+	}
+
+	// Breadth first, the failure state of each state is shallower and done
+	// already: a missing transition becomes that of the failure state, and a
+	// state also matches what its failure state matches.
+	std::vector<int> failure(matches.size(), 0);
+	std::vector<int> queue;
+	for (int c = 0; c < 256; c++)
+	{
+		int &next = transitions[c];
+		if (next < 0)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		int state = queue[head];
+		matches[state] |= matches[failure[state]];
+		for (int c = 0; c < 256; c++)
+		{
+			int &next = transitions[state * 256 + c];
+			int fallback = transitions[failure[state] * 256 + c];
+			if (next < 0)
+				next = fallback;
+			else
+			{
+				failure[next] = fallback;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	// The texts are lowercase, an uppercase letter goes where its lowercase does
+	for (size_t state = 0; state < matches.size(); state++)
+		for (int c = 'A'; c <= 'Z'; c++)
+			transitions[state * 256 + c] = transitions[state * 256 + tolower(c)];
+}
+
+bool ODBCStatementFilter::traced(const std::string &statement, const std::string &dsn) const
+{
+	int match = process_match;
+	if (!this->dsn.empty())
+	{
+		std::string name = filterLower(dsn);
+		for (size_t i = 0; i < this->dsn.size(); i++)
+			if (this->dsn[i].text == name)
+				match |= this->dsn[i].match;
+	}
+
+	if (!transitions.empty() && !(match & MATCH_EXCLUDE) && (sql_excludes || !(match & MATCH_INCLUDE)))
+	{
+		const int *table = transitions.data();
+		const unsigned char *text = (const unsigned char*)statement.data();
+		int state = 0;
+		for (size_t i = 0; i < statement.size(); i++)
+		{
+			state = table[state * 256 + text[i]];
+			match |= matches[state];
+			// Decided once an exclude rule matched, or an include rule did
+			// and no SQL exclude rule could still match
+			if ((match & MATCH_EXCLUDE) || ((match & MATCH_INCLUDE) && !sql_excludes))
+				break;
+		}
+	}
+	return !(match & MATCH_EXCLUDE) && (!includes || (match & MATCH_INCLUDE));
+}
+
+bool ODBCStatementFilter::usesDsn() const
+{
+	return !dsn.empty();
+}
+
+size_t ODBCStatementFilter::rules() const
+{
+	return sql.size() + dsn.size() + process.size();
+}
@@ -0,0 +1,58 @@
+#if !defined(ODBCSTATEMENTFILTER_H)
+#define ODBCSTATEMENTFILTER_H
+
+#include <string>
+#include <vector>
+
+// Decides which statements are traced, by the "include" and "exclude" rules
+// of the config file. A rule is "sql:<text>", matching the text anywhere in
+// the statement ignoring case, "dsn:<name>" or "process:<name>", matching the
+// whole name ignoring case. A statement is traced when it matches no exclude
+// rule and, if there are include rules, one of them.
+//
+// The SQL texts of all rules are compiled into one Aho-Corasick automaton
+// whose failure links are resolved into a table of transitions, so a
+// statement is read once, a character at a time, however many rules there
+// are. The decision is taken when a statement is prepared or executed and
+// kept in its state: fetches of an excluded statement are not counted and
+// closing it writes nothing.
+class ODBCStatementFilter
+{
+public:
+	ODBCStatementFilter();
+	// False if the rule is not one.
+	bool add(bool include, const std::string &rule);
+	// Builds the automaton once all rules were added.
+	void compile();
+	bool traced(const std::string &statement, const std::string &dsn) const;
+	// The DSN of a statement's connection needs looking up for the rules.
+	bool usesDsn() const;
+	size_t rules() const;
+
+private:
+	enum
+	{
+		MATCH_INCLUDE = 1,
+		MATCH_EXCLUDE = 2
+	};
+
+	struct Rule
+	{
+		int match;
+		std::string text;
+	};
+
+	std::vector<Rule> sql;
+	std::vector<Rule> dsn;
+	std::vector<Rule> process;
+	bool includes;
+	bool sql_excludes;
+	// What the process rules matched, the process never changes
+	int process_match;
+	// 256 transitions per state, state 0 is the start, and what each state
+	// matched
+	std::vector<int> transitions;
+	std::vector<unsigned char> matches;
+};
+
+#endif //#if !defined(ODBCSTATEMENTFILTER_H)
@@ -0,0 +1,208 @@
+#include "StdAfx.h"
+
+#include "sql.h"
+#include "sqlext.h"
+#include "ODBCTracer.h"
+#include "ODBCHandles.h"
+#include "ODBCTimeline.h"
+
+ODBCTimelineBuffer::ODBCTimelineBuffer() : attached(false)
+{
+}
+
+ODBCTimelineBuffer::~ODBCTimelineBuffer()
+{
+	// The thread exits, its events go to the file now
+	if (attached)
+		ODBCTimeline::get()->detach(this);
+}
+
+ODBCTimeline* ODBCTimeline::inst;
+ODBCTimeline* ODBCTimeline::get()
+{
+	if (inst == NULL)
+		inst = new ODBCTimeline();
+	return inst;
+}
+
+ODBCTimeline::ODBCTimeline() : active(false), pid(0), file(NULL)
+{
+}
+
+void ODBCTimeline::open(const std::string &logfile)
+{
+	close();
+
+	std::string path = ODBCProcessFile(logfile, ".trace.json");
+
+	MutexGuard guard(&lock);
+	pid = ODBCProcessId();
+	file = fopen(path.c_str(), "w");
+	if (!file)
+		return;
+
+	std::string events = "[\n";
+	ODBCSerializer event(OUTPUT_JSON, &events);
+	event.text("name", "process_name", 12);
+	event.text("ph", "M", 1);
+	event.number("pid", pid);
+	event.object("args");
+	event.text("name", ODBCProcessName());
+	event.end();
+	event.end();
+	events.append(",\n", 2);
+	write(events);
+	active = true;
+}
+
+void ODBCTimeline::close()
+{
+	if (!active.exchange(false))
+		return;
+
+	MutexGuard guard(&lock);
+	for (std::set<ODBCTimelineBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+	{
+		std::string events;
+		{
+			MutexGuard buffer_guard(&(*it)->lock);
+			events.swap((*it)->events);
+			(*it)->named.clear();
+		}
+		write(events);
+	}
+
+	// Ends the array without a trailing comma, so strict JSON parsers read it too
+	std::string events;
+	ODBCSerializer event(OUTPUT_JSON, &events);
+	event.text("name", "trace_end", 9);
+	event.text("ph", "i", 1);
+	event.number("ts", ODBCTraceNow());
+	event.number("pid", pid);
+	event.number("tid", ODBCThreadId());
+	event.end();
+	events.append("\n]\n", 3);
+	write(events);
+	fclose(file);
+	file = NULL;
+}
+
+void ODBCTimeline::detach(ODBCTimelineBuffer *buffer)
+{
+	MutexGuard guard(&lock);
+	buffers.erase(buffer);
+	MutexGuard buffer_guard(&buffer->lock);
+	if (file)
+		write(buffer->events);
+	buffer->events.clear();
+	buffer->attached = false;
+}
+
+ODBCTimelineBuffer* ODBCTimeline::buffer()
+{
+	static thread_local ODBCTimelineBuffer local;
+	if (!local.attached)
+	{
+		MutexGuard guard(&lock);
+		buffers.insert(&local);
+		local.attached = true;
+	}
+	return &local;
+}
+
+// Appends the events of a buffer to the file once it is full. Called by the
+// thread of the buffer, which holds no lock.
+void ODBCTimeline::hand(ODBCTimelineBuffer *buffer)
+{
+	std::string events;
+	{
+		MutexGuard guard(&buffer->lock);
+		if (buffer->events.size() < ODBCTIMELINE_FLUSHSIZE)
+			return;
+		events.swap(buffer->events);
+		buffer->events.reserve(ODBCTIMELINE_FLUSHSIZE + 1024);
+	}
+	MutexGuard guard(&lock);
+	if (file)
+		write(events);
+}
+
+// The caller holds the lock.
+void ODBCTimeline::write(const std::string &events)
+{
+	if (file && !events.empty())
+		fwrite(events.data(), 1, events.size(), file);
+}
+
+void ODBCTimeline::call(ODBCTraceCall *call, long long end_time)
+{
+	if (!active)
+		return;
+
+	ODBCTimelineBuffer *local = buffer();
+	{
+		MutexGuard guard(&local->lock);
+		ODBCSerializer event(OUTPUT_JSON, &local->events);
+		event.text("name", call->function_name, strlen(call->function_name));
+		event.text("cat", "call", 4);
+		event.text("ph", "X", 1);
+		event.number("ts", call->begin_time);
+		event.number("dur", end_time - call->begin_time);
+		event.number("pid", pid);
+		event.number("tid", call->thread_id);
+		event.object("args");
+		if (call->arguments_count > 0 && call->arguments[0].type >= TYP_SQLHDESC && call->arguments[0].type <= TYP_SQLHANDLE)
+			event.hex(call->arguments[0].name.c_str(), (uintptr_t)call->arguments[0].value);
+		event.number("retcode", call->retcode);
+		event.end();
+		event.end();
+		local->events.append(",\n", 2);
+	}
+	hand(local);
+}
+
+void ODBCTimeline::statement(ODBCStatementState *stmt, long long end_time)
+{
+	if (!active)
+		return;
+
+	// Statements go on a track per connection, the handle serves as its id
+	unsigned long long track = (uintptr_t)stmt->hdbc;
+	ODBCTimelineBuffer *local = buffer();
+	{
+		MutexGuard guard(&local->lock);
+		if (local->named.insert(stmt->hdbc).second)
+		{
+			char name[32];
+			sprintf(name, "hdbc %p", stmt->hdbc);
+			ODBCSerializer track_name(OUTPUT_JSON, &local->events);
+			track_name.text("name", "thread_name", 11);
+			track_name.text("ph", "M", 1);
+			track_name.number("pid", pid);
+			track_name.number("tid", track);
+			track_name.object("args");
+			track_name.text("name", name, strlen(name));
+			track_name.end();
+			track_name.end();
+			local->events.append(",\n", 2);
+		}
+
+		ODBCSerializer event(OUTPUT_JSON, &local->events);
+		event.text("name", stmt->fingerprint().text);
+		event.text("cat", "statement", 9);
+		event.text("ph", "X", 1);
+		event.number("ts", stmt->begin_time);
+		event.number("dur", end_time - stmt->begin_time);
+		event.number("pid", pid);
+		event.number("tid", track);
+		event.object("args");
+		event.hex("hstmt", (uintptr_t)stmt->hstmt);
+		event.number("rows", stmt->record_count);
+		event.number("retcode", stmt->retcode);
+		event.text("sql", stmt->statement);
+		event.end();
+		event.end();
+		local->events.append(",\n", 2);
+	}
+	hand(local);
+}
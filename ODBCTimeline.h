@@ -0,0 +1,58 @@
+#if !defined(ODBCTIMELINE_H)
+#define ODBCTIMELINE_H
+
+#include <atomic>
+#include <set>
+
+// Bytes of events a thread collects before it appends them to the file.
+#define ODBCTIMELINE_FLUSHSIZE (64 * 1024)
+
+// Events of one thread. Only its thread appends to it; the lock is taken by
+// other threads only when the timeline closes.
+struct ODBCTimelineBuffer
+{
+	ODBCTimelineBuffer();
+	~ODBCTimelineBuffer();
+	Mutex lock;
+	std::string events;
+	// Connections whose track this thread has named already
+	std::set<const void*> named;
+	bool attached;
+};
+
+// Writes a timeline of the traced calls in the Chrome trace-event format,
+// which chrome://tracing and ui.perfetto.dev open, when the log file name
+// contains "_timeline". Every call from its Trace* entry to TraceReturn is a
+// duration event on the track of its thread; every statement from
+// SQLPrepare/SQLExecDirect until its cursor is closed is one on the track of
+// its connection. Each process writes <log file>.<pid>.trace.json as a JSON
+// array, whose closing bracket the viewers do not need, so a process that
+// dies still leaves a readable file.
+class ODBCTimeline
+{
+private:
+	static ODBCTimeline* inst;
+
+public:
+	static ODBCTimeline* get();
+	ODBCTimeline();
+	void open(const std::string &logfile);
+	void close();
+	void call(ODBCTraceCall *call, long long end_time);
+	void statement(ODBCStatementState *stmt, long long end_time);
+	void detach(ODBCTimelineBuffer *buffer);
+
+private:
+	ODBCTimelineBuffer* buffer();
+	void hand(ODBCTimelineBuffer *buffer);
+	void write(const std::string &events);
+
+	std::atomic<bool> active;
+	// getpid is a system call on current glibc
+	unsigned long pid;
+	Mutex lock;
+	FILE* file;
+	std::set<ODBCTimelineBuffer*> buffers;
+};
+
+#endif //#if !defined(ODBCTIMELINE_H)
@@ -0,0 +1,76 @@
+#include "StdAfx.h"
+
+#include "ODBCTracer.h"
+#include "ODBCFingerprint.h"
+#include "ODBCTimeouts.h"
+
+ODBCTimeoutEntry::ODBCTimeoutEntry() : timeouts(0), timeout_time(0), cancels(0), cancel_time(0), cancel_max(0)
+{
+}
+
+ODBCTimeouts* ODBCTimeouts::inst;
+ODBCTimeouts* ODBCTimeouts::get()
+{
+	if (inst == NULL)
+		inst = new ODBCTimeouts();
+	return inst;
+}
+
+ODBCTimeouts::ODBCTimeouts() : fingerprints(ODBCTIMEOUTS_TRACKED)
+{
+}
+
+// Called with the lock held.
+ODBCTimeoutEntry* ODBCTimeouts::entry(const ODBCFingerprint &fingerprint)
+{
+	auto it = fingerprints.find(fingerprint.hash);
+	if (it == fingerprints.end())
+	{
+		it = fingerprints.insert(fingerprint.hash, ODBCTimeoutEntry());
+		it->second.text = fingerprint.text;
+	}
+	return &it->second;
+}
+
+void ODBCTimeouts::timedOut(const ODBCFingerprint &fingerprint, long long elapsed)
+{
+	MutexGuard guard(&lock);
+	ODBCTimeoutEntry *entry = this->entry(fingerprint);
+	entry->timeouts++;
+	entry->timeout_time += elapsed;
+}
+
+void ODBCTimeouts::cancelled(const ODBCFingerprint &fingerprint, long long latency)
+{
+	MutexGuard guard(&lock);
+	ODBCTimeoutEntry *entry = this->entry(fingerprint);
+	entry->cancels++;
+	entry->cancel_time += latency;
+	entry->cancel_max = std::max(entry->cancel_max, latency);
+}
+
+static bool compareCount(const ODBCTimeoutEntry *a, const ODBCTimeoutEntry *b)
+{
+	return a->timeouts + a->cancels > b->timeouts + b->cancels;
+}
+
+void ODBCTimeouts::report()
+{
+	MutexGuard guard(&lock);
+	std::vector<const ODBCTimeoutEntry*> entries;
+	for (auto it = fingerprints.begin(); it != fingerprints.end(); ++it)
+		entries.push_back(&it->second);
+	std::sort(entries.begin(), entries.end(), compareCount);
+
+	std::string prefix = std::to_string(ODBCProcessId()) + " timeouts ";
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const ODBCTimeoutEntry *entry = entries[i];
+		long long timeout = entry->timeouts > 0 ? entry->timeout_time / (long long)entry->timeouts : 0;
+		long long cancel = entry->cancels > 0 ? entry->cancel_time / (long long)entry->cancels : 0;
+		ODBCWriteLog(prefix + ODBCFormatNumber(entry->timeouts) + " Timeouts " + ODBCFormatNumber(timeout / 1000) + "ms avg " +
+			ODBCFormatNumber(entry->cancels) + " Cancels " + ODBCFormatNumber(cancel / 1000) + "ms avg (max " +
+			ODBCFormatNumber(entry->cancel_max / 1000) + "ms) " + entry->text);
+	}
+	fingerprints.clear();
+}
@@ -0,0 +1,54 @@
+#if !defined(ODBCTIMEOUTS_H)
+#define ODBCTIMEOUTS_H
+
+#include "ODBCRecentMap.h"
+
+// Fingerprints followed at once, the one that timed out or was cancelled
+// least recently makes room for a new one.
+#define ODBCTIMEOUTS_TRACKED 1024
+
+struct ODBCTimeoutEntry
+{
+	ODBCTimeoutEntry();
+	std::string text;
+	// Statements that ended in HYT00 or HYT01
+	unsigned long long timeouts;
+	long long timeout_time;
+	// Calls SQLCancel interrupted and microseconds from the SQLCancel to
+	// their return
+	unsigned long long cancels;
+	long long cancel_time;
+	long long cancel_max;
+};
+
+// Counts per fingerprint the statements that hit a timeout, as the
+// application learns from SQLGetDiagRec or SQLError returning SQLSTATE HYT00
+// (query timeout) or HYT01 (connection timeout) for the statement, and the
+// calls SQLCancel interrupted with how long they took to return after it.
+// The trace stack pairs an SQLCancel with the calls on the same statement in
+// flight in other threads when it enters. Fingerprints that timed out or were
+// cancelled are reported by their count when the log is closed:
+// "<pid> timeouts N Timeouts Xms avg C Cancels Yms avg (max Zms) <text>".
+class ODBCTimeouts
+{
+private:
+	static ODBCTimeouts* inst;
+
+public:
+	static ODBCTimeouts* get();
+	ODBCTimeouts();
+	// The statement timed out after that many microseconds.
+	void timedOut(const ODBCFingerprint &fingerprint, long long elapsed);
+	// A call on the statement returned that many microseconds after an
+	// SQLCancel entered.
+	void cancelled(const ODBCFingerprint &fingerprint, long long latency);
+	void report();
+
+private:
+	ODBCTimeoutEntry* entry(const ODBCFingerprint &fingerprint);
+
+	Mutex lock;
+	ODBCRecentMap<ODBCTimeoutEntry> fingerprints;
+};
+
+#endif //#if !defined(ODBCTIMEOUTS_H)
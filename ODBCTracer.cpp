@@ -1,8 +1,21 @@
-#include "stdafx.h"
+#include "StdAfx.h"
 
 #include "sql.h"
 #include "sqlext.h"
 #include "ODBCTracer.h"
+#include "ODBCHandles.h"
+#include "ODBCMetrics.h"
+#include "ODBCCollector.h"
+#include "ODBCLogWriter.h"
+#include "ODBCTimeline.h"
+#include "ODBCSpanExporter.h"
+#include "ODBCConcurrency.h"
+#include "ODBCOverhead.h"
+#include "ODBCConfig.h"
+#include "ODBCStatementFilter.h"
+#include "ODBCPrepareAdvisor.h"
+#include "ODBCRepeatDetector.h"
+#include "ODBCTimeouts.h"
 #include <assert.h>
 
 ODBCTraceOptions* ODBCTraceOptions::inst;
@@ -15,36 +28,6 @@ ODBCTraceOptions* ODBCTraceOptions::get()
 
 ODBCTraceStack stack;
 
-Mutex::Mutex()
-{
-	InitializeCriticalSection(&CriticalSection); 
-}
-
-Mutex::~Mutex()
-{
-    DeleteCriticalSection(&CriticalSection);
-}
-
-void Mutex::enter()
-{
-    EnterCriticalSection(&CriticalSection); 
-}
-
-void Mutex::leave()
-{
-    LeaveCriticalSection(&CriticalSection);
-}
-
-MutexGuard::MutexGuard(Mutex *mutex) : mutex(mutex)
-{
-	mutex->enter();
-}
-
-MutexGuard::~MutexGuard()
-{
-	mutex->leave();
-}
-
 void ODBCTraceCall::insertArgument(const char *name, ODBCTracer_ArgumentTypes type, void *value)
 {
 	arguments[arguments_count].name = name;
@@ -54,19 +37,60 @@ void ODBCTraceCall::insertArgument(const char *name, ODBCTracer_ArgumentTypes ty
 	assert(arguments_count < MAX_ARGUMENTS);
 }
 
-ODBCTraceStack::ODBCTraceStack()
+ODBCTraceStack::ODBCTraceStack() : in_flight(0), sequence(0)
 {
 	for (int i = 0; i < ODBCTRACE_STACKSIZE; i++)
 		stack[i] = NULL;
 }
 
 int ODBCTraceStack::push(ODBCTraceCall *call)
+{
+	const ODBCConfig *config = ODBCConfig::current();
+	// TraceReturn ignores the index of a call that is not traced
+	if (!config->traced(call->function_id))
+	{
+		delete call;
+		return -1;
+	}
+	bool concurrency = config->concurrency;
+	if (concurrency)
+		call->driver = ODBCConcurrency::get()->driver(call);
+	call->thread_id = ODBCThreadId();
+	call->begin_time = ODBCTraceNow();
+	int index = place(call, concurrency);
+	if (call->hook_time != 0)
+		ODBCOverhead::get()->hooked(call, ODBCTraceNanoseconds());
+	return index;
+}
+
+int ODBCTraceStack::place(ODBCTraceCall *call, bool concurrency)
 {
 	MutexGuard guard(&lock);
 	for (int i = 0; i < ODBCTRACE_STACKSIZE; i++)
 		if (stack[i] == NULL)
 		{
+			call->sequence = ++sequence;
+			// The calls on the stack are the ones in flight
+			if (in_flight > 0 && concurrency)
+				for (int j = 0; j < ODBCTRACE_STACKSIZE; j++)
+					if (stack[j] != NULL && stack[j]->thread_id != call->thread_id && stack[j]->driver == call->driver)
+					{
+						stack[j]->overlapped = true;
+						call->overlapped = true;
+						call->entered_busy = true;
+					}
+			// An SQLCancel interrupts the calls on its statement that other
+			// threads are running, they return the sooner the better
+			if (in_flight > 0 && call->function_id == SQL_API_SQLCANCEL)
+				for (int j = 0; j < ODBCTRACE_STACKSIZE; j++)
+					if (stack[j] != NULL && stack[j]->thread_id != call->thread_id && stack[j]->cancel_time == 0 &&
+						stack[j]->arguments_count > 0 && stack[j]->arguments[0].value == call->arguments[0].value)
+					{
+						stack[j]->cancel_time = call->begin_time;
+						call->cancel_targets++;
+					}
 			stack[i] = call;
+			in_flight++;
 			return i;
 		}
 	return -1;
@@ -74,37 +98,127 @@ int ODBCTraceStack::push(ODBCTraceCall *call)
 
 ODBCTraceCall* ODBCTraceStack::pop(int index)
 {
+	// A full stack or a disabled function gave the call no index
+	if (index < 0 || index >= ODBCTRACE_STACKSIZE)
+		return NULL;
 	MutexGuard guard(&lock);
 	ODBCTraceCall *call = stack[index];
 	stack[index] = NULL;
+	if (call == NULL)
+		return NULL;
+	in_flight--;
+	// A call that entered while another thread's call ran either returns
+	// after all of those did, as if it had queued behind them, or overtakes
+	// one of them, which a driver serializing its calls never lets happen.
+	if (call->entered_busy)
+		for (int j = 0; j < ODBCTRACE_STACKSIZE && !call->overtook; j++)
+			if (stack[j] != NULL && stack[j]->thread_id != call->thread_id && stack[j]->driver == call->driver &&
+				stack[j]->sequence < call->sequence)
+				call->overtook = true;
 	return call;
 }
 
+static size_t ODBCLogFileExtension(const std::string &logfile)
+{
+	size_t directory = logfile.find_last_of("\\/");
+	size_t extension = logfile.rfind('.');
+	if (extension == std::string::npos || (directory != std::string::npos && extension < directory))
+		extension = logfile.size();
+	return extension;
+}
+
+// A new CSV log starts with the header, a log appended to already has it.
+static bool ODBCLogFileEmpty(const std::string &logfile)
+{
+	FILE* file = fopen(logfile.c_str(), "r");
+	if (!file)
+		return true;
+	bool empty = fgetc(file) == EOF;
+	fclose(file);
+	return empty;
+}
+
+// Exported unmangled, the driver manager looks the entry points up by name
+extern "C" {
+
 RETCODE	SQL_API TraceOpenLogFile(LPWSTR s, LPWSTR t, DWORD w)
 {
-	std::wstring ws(s);
-	std::string str(ws.begin(), ws.end());
+	std::string str = ODBCNarrow(s, -1);
 
 	//Pause for attaching
 	//MessageBox(NULL, str.c_str(), "Log file", MB_OK | MB_ICONQUESTION);
-	ODBCTraceOptions::get()->logfile = str;
-	ODBCTraceOptions::get()->recordLogging = str.find("_nc") == std::string::npos;
+	ODBCTraceOptions::get()->logfile = str.find("_pid") != std::string::npos ? ODBCProcessLogFile(str) : str;
+	ODBCTraceOptions::get()->collector = str.find("_collector") != std::string::npos;
+	ODBCConfig config;
+	config.recordLogging = str.find("_nc") == std::string::npos;
+	config.replayLogging = str.find("_replay") != std::string::npos;
+	config.concurrency = str.find("_concurrency") != std::string::npos;
+	config.format = str.find("_json") != std::string::npos ? OUTPUT_JSON :
+		str.find("_csv") != std::string::npos ? OUTPUT_CSV : OUTPUT_TEXT;
+	ODBCConfigFile::get()->open(str.substr(0, ODBCLogFileExtension(str)) + ".config", config);
+	ODBCOverhead::get()->open(&stack.lock);
+	// With the collector the CSV header goes into the fallback file only
+	if (ODBCTraceOptions::get()->collector)
+	{
+		const std::string &endpoint = ODBCConfig::current()->collector;
+		ODBCCollector::get()->open(ODBCProcessLogFile(str), endpoint.empty() ? ODBCCollectorDefaultEndpoint(false) : endpoint);
+	}
+	else
+	{
+		ODBCLogWriter::get()->open(ODBCTraceOptions::get()->logfile);
+		if (ODBCConfig::current()->format == OUTPUT_CSV && ODBCLogFileEmpty(ODBCTraceOptions::get()->logfile))
+			ODBCWriteLine(ODBCCSV_HEADER);
+	}
+	ODBCConfigFile::get()->watch();
+	if (str.find("_timeline") != std::string::npos)
+		ODBCTimeline::get()->open(ODBCTraceOptions::get()->logfile);
+	if (str.find("_otlp") != std::string::npos)
+		ODBCSpanExporter::get()->open(ODBCTraceOptions::get()->logfile);
+	ODBCMetrics::get()->open();
 	return 0;
 }
 
 RETCODE	SQL_API TraceCloseLogFile()
 {
+	ODBCConfigFile::get()->close();
+	ODBCHandleReport();
+	ODBCConcurrency::get()->report();
+	ODBCPrepareAdvisor::get()->report();
+	ODBCRepeatDetector::get()->report();
+	ODBCTimeouts::get()->report();
+	ODBCOverhead::get()->close();
+	ODBCCollector::get()->close();
+	ODBCLogWriter::get()->close();
+	ODBCTimeline::get()->close();
+	ODBCSpanExporter::get()->close();
+	ODBCMetrics::get()->close();
 	return 0;
 }
 
 VOID SQL_API TraceReturn(RETCODE rethandle, RETCODE retcode)
 {
+	long long start = ODBCTraceNanoseconds();
 	ODBCTraceCall* call = stack.pop(rethandle);
 	if (call != NULL)
 	{
+		bool sampled = call->hook_time != 0;
+		if (sampled)
+			ODBCOverhead::get()->returned(call, start);
+		long long end_time = start / 1000;
+		call->end_time = end_time;
 		call->retcode = retcode;
+		long long trace_start = sampled ? ODBCTraceNanoseconds() : 0;
 		ODBCTrace(call);
+		if (call->cancel_time != 0)
+			ODBCTraceCancelled(call);
+		if (sampled)
+			ODBCOverhead::get()->add(OVERHEAD_TRACE, ODBCTraceNanoseconds() - trace_start);
+		ODBCMetrics::get()->call(call, end_time);
+		ODBCTimeline::get()->call(call, end_time);
+		ODBCConcurrency::get()->call(call);
 		delete call;
+		if (sampled)
+			ODBCOverhead::get()->finished(start, ODBCTraceNanoseconds());
 	}
 }
 
@@ -113,139 +227,595 @@ DWORD SQL_API TraceVersion()
 	return TRACE_VERSION;
 }
 
+}
+
+std::string ODBCFormatNumber(long long number)
+{
+	std::string number_str = std::to_string(number);
+	for (int i = number_str.length() - 3; i > (number < 0 ? 1 : 0); i -= 3)
+		number_str.insert(i, ",");
+	return number_str;
+}
+
+std::string ODBCArgumentString(const ODBCTraceArgument *text, const ODBCTraceArgument *length)
+{
+	if (text->value == NULL)
+		return "";
+
+	long len = length ? (long)(intptr_t)length->value : SQL_NTS;
+	if (length && length->type != TYP_SQLINTEGER)
+		len = (SQLSMALLINT)len;
+
+	if (text->type == TYP_SQLWCHAR_PTR)
+	{
+		return ODBCNarrow((SQLWCHAR*)text->value, len == SQL_NTS ? -1 : (len < 0 ? 0 : len));
+	}
+	return len == SQL_NTS ? std::string((char*)text->value) : std::string((char*)text->value, len < 0 ? 0 : len);
+}
+
+const std::string& ODBCProcessName()
+{
+	static std::string name;
+	if (name.empty())
+	{
+		std::string cmdLine = ODBCExecutablePath();
+
+		std::transform(cmdLine.begin(), cmdLine.end(), cmdLine.begin(), ::tolower);
+		if (cmdLine.find("excel") != std::string::npos)
+		{
+			cmdLine = "excel";
+		}
+
+		// File name without directory and extension
+		size_t begin = cmdLine.find_last_of("\\/:");
+		begin = begin == std::string::npos ? 0 : begin + 1;
+		size_t end = cmdLine.rfind('.');
+		name = cmdLine.substr(begin, end == std::string::npos || end < begin ? std::string::npos : end - begin);
+		if (name.empty())
+			name = "unknown";
+	}
+	return name;
+}
+
+// The log file of this process only: the pid goes in front of the extension.
+std::string ODBCProcessLogFile(const std::string &logfile)
+{
+	size_t extension = ODBCLogFileExtension(logfile);
+	return logfile.substr(0, extension) + "." + std::to_string(ODBCProcessId()) + logfile.substr(extension);
+}
+
+std::string ODBCProcessFile(const std::string &logfile, const std::string &suffix)
+{
+	return logfile.substr(0, ODBCLogFileExtension(logfile)) + "." + std::to_string(ODBCProcessId()) + suffix;
+}
+
+std::string ODBCFormatLine(const std::string &log)
+{
+	ODBCOutputFormat format = ODBCConfig::current()->format;
+	if (format == OUTPUT_TEXT)
+		return ODBCLocalTime() + " " + ODBCProcessName() + " " + log;
+
+	// "<pid> <type> <text>" becomes a record of that type
+	size_t type = log.find(' ');
+	type = type == std::string::npos ? log.size() : type + 1;
+	size_t text = log.find(' ', type);
+	text = text == std::string::npos ? log.size() : text;
+
+	std::string line;
+	ODBCSerializer record(format, &line);
+	record.number("time", ODBCWallClockMilliseconds());
+	record.text("process", ODBCProcessName());
+	record.number("pid", ODBCProcessId());
+	record.text("type", log.data() + type, text - type);
+	record.null("connection");
+	record.null("statement");
+	record.null("begin_us");
+	record.null("elapsed_us");
+	record.null("rows");
+	record.null("retcode");
+	record.null("fingerprint");
+	record.text("text", log.data() + std::min(text + 1, log.size()), log.size() - std::min(text + 1, log.size()));
+	record.end();
+	return line;
+}
+
+void ODBCWriteLine(const std::string &line)
+{
+	long long start = ODBCOverhead::get()->sampling() ? ODBCTraceNanoseconds() : 0;
+	if (ODBCTraceOptions::get()->collector)
+		ODBCCollector::get()->write(line);
+	else
+		ODBCLogWriter::get()->write(line);
+	if (start != 0)
+		ODBCOverhead::get()->add(OVERHEAD_WRITE, ODBCTraceNanoseconds() - start);
+	ODBCMetrics::get()->written(line.size() + 1);
+}
+
 void ODBCWriteLog(std::string log)
 {
-	FILE* file = fopen(ODBCTraceOptions::get()->logfile.c_str(), "a");
-	if (file)
+	ODBCWriteLine(ODBCFormatLine(log));
+}
+
+// Writes a closed statement as a JSON or CSV record into a line reused by
+// the thread.
+static void ODBCWriteStatementRecord(ODBCStatementState *stmt, long long end_time, ODBCOutputFormat format, bool rows)
+{
+	static thread_local std::string line;
+	line.clear();
+	ODBCSerializer record(format, &line);
+	record.number("time", ODBCWallClockMilliseconds());
+	record.text("process", ODBCProcessName());
+	record.number("pid", ODBCProcessId());
+	record.text("type", "statement", 9);
+	record.hex("connection", (uintptr_t)stmt->hdbc);
+	record.hex("statement", (uintptr_t)stmt->hstmt);
+	record.number("begin_us", stmt->begin_time);
+	record.number("elapsed_us", end_time - stmt->begin_time);
+	if (rows)
+		record.number("rows", stmt->record_count);
+	else
+		record.null("rows");
+	record.number("retcode", stmt->retcode);
+	record.hex("fingerprint", stmt->fingerprint().hash);
+	record.text("text", stmt->statement);
+	record.end();
+	ODBCWriteLine(line);
+}
+
+static const char *gapBuckets[ODBCSTATEMENT_GAPBUCKETS] = { "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s" };
+
+// "<pid> breakdown <connection> Xms Yms Driver Zms Client driver-bound|
+// client-bound [Cms CPU P%] Gaps <10us:N ... >=1s:N <text>": where the time
+// of a statement went, the driver calls on it or the application between
+// them, the CPU time the thread used meanwhile as a share of the elapsed
+// time, and how long the application took between two fetches.
+static void ODBCTraceBreakdown(ODBCStatementState *stmt, ODBCConnectionState *connection, long long elapsed, long long cpu)
+{
+	long long client = std::max(elapsed - stmt->driver_time, 0LL);
+	std::string output = std::to_string(ODBCProcessId()) + " breakdown " + connection->name() + " " +
+		ODBCFormatNumber(elapsed / 1000) + "ms " + ODBCFormatNumber(stmt->driver_time / 1000) + "ms Driver " +
+		ODBCFormatNumber(client / 1000) + "ms Client " + (stmt->driver_time >= client ? "driver-bound" : "client-bound");
+	if (cpu >= 0)
+	{
+		char percent[32];
+		sprintf(percent, "%.1f%%", elapsed > 0 ? 100.0 * cpu / elapsed : 0.0);
+		output.append(" " + ODBCFormatNumber(cpu / 1000) + "ms CPU " + percent);
+	}
+	output.append(" Gaps");
+	for (int i = 0; i < ODBCSTATEMENT_GAPBUCKETS; i++)
+		output.append(" " + std::string(gapBuckets[i]) + ":" + ODBCFormatNumber(stmt->gaps[i]));
+	ODBCWriteLog(output + " " + stmt->fingerprint().text);
+}
+
+// "<pid> result <connection> N: Xms [R Recs] [A Affected] <text>" for result
+// set N of a batch, counted from 0, once SQLMoreResults moved past it or the
+// statement was closed: its time from the end of the previous one, the
+// records fetched from it and the rows SQLRowCount reported for a DML one.
+// A JSON or CSV record of type "result" has the affected rows of a DML
+// result set as its rows, else the records, and "N: <text>" as its text.
+static void ODBCTraceResultSet(ODBCStatementState *stmt, ODBCConnectionState *connection, long long end_time)
+{
+	const ODBCConfig *config = ODBCConfig::current();
+	long long records = stmt->record_count - stmt->result_records;
+	if (config->format == OUTPUT_TEXT)
+	{
+		std::string output = std::to_string(ODBCProcessId()) + " result " + connection->name() + " " +
+			std::to_string(stmt->result_set) + ": " + ODBCFormatNumber((end_time - stmt->result_begin) / 1000) + "ms ";
+		if (config->recordLogging)
+			output.append(ODBCFormatNumber(records) + " Recs ");
+		if (stmt->row_count >= 0)
+			output.append(ODBCFormatNumber(stmt->row_count) + " Affected ");
+		ODBCWriteLog(output + stmt->fingerprint().text);
+	}
+	else
+	{
+		static thread_local std::string line;
+		line.clear();
+		ODBCSerializer record(config->format, &line);
+		record.number("time", ODBCWallClockMilliseconds());
+		record.text("process", ODBCProcessName());
+		record.number("pid", ODBCProcessId());
+		record.text("type", "result", 6);
+		record.hex("connection", (uintptr_t)stmt->hdbc);
+		record.hex("statement", (uintptr_t)stmt->hstmt);
+		record.number("begin_us", stmt->result_begin);
+		record.number("elapsed_us", end_time - stmt->result_begin);
+		if (stmt->row_count >= 0)
+			record.number("rows", stmt->row_count);
+		else if (config->recordLogging || config->replayLogging)
+			record.number("rows", records);
+		else
+			record.null("rows");
+		record.null("retcode");
+		record.hex("fingerprint", stmt->fingerprint().hash);
+		record.text("text", std::to_string(stmt->result_set) + ": " + stmt->statement);
+		record.end();
+		ODBCWriteLine(line);
+	}
+	stmt->result_set++;
+	stmt->result_begin = end_time;
+	stmt->result_records = stmt->record_count;
+	stmt->row_count = -1;
+}
+
+// The statement of a replay line exactly as it was executed: a line break
+// would end the line and folding it into a space would turn the rest of a
+// line after "--" into a comment, so backslashes, line feeds and carriage
+// returns are written as "\\", "\n" and "\r".
+static std::string ODBCReplayEscape(const std::string &statement)
+{
+	std::string escaped;
+	escaped.reserve(statement.size());
+	for (size_t i = 0; i < statement.size(); i++)
+	{
+		char c = statement[i];
+		if (c == '\\')
+			escaped.append("\\\\");
+		else if (c == '\n')
+			escaped.append("\\n");
+		else if (c == '\r')
+			escaped.append("\\r");
+		else
+			escaped.push_back(c);
+	}
+	return escaped;
+}
+
+// Writes the line of a statement whose cursor is being closed by the call
+// and clears it.
+static void ODBCTraceStatement(SQLHSTMT hstmt, ODBCTraceCall *call)
+{
+	ODBCTraceOptions* option = ODBCTraceOptions::get();
+	const ODBCConfig *config = ODBCConfig::current();
+	std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(hstmt, false);
+
+	if (stmt == NULL || stmt->statement == "")
+		return;
+	if (stmt->excluded)
 	{
-		std::string cmdLine = GetCommandLine();
-		auto pos1 = cmdLine.find('\"');
-		if (pos1 >= 0)
+		ODBCMetrics::get()->statementClosed();
+		stmt->clear();
+		return;
+	}
+
+	long long end_time = ODBCTraceNow();
+	long long cpu = stmt->cpuTime(call->thread_id);
+	stmt->driver_time += call->end_time - call->begin_time;
+	std::shared_ptr<ODBCConnectionState> connection = ODBCHandleTable::get()->connection(stmt->hdbc);
+	bool loop;
+	{
+		MutexGuard guard(&connection->lock);
+		loop = connection->loops.statement(config, stmt->fingerprint(), stmt->begin_time, end_time, stmt->record_count, connection->name());
+		ODBCSpanExporter::get()->statement(connection.get(), stmt.get(), end_time);
+	}
+
+	// The last result set of a batch SQLMoreResults moved through
+	if (!loop && stmt->result_set > 0)
+		ODBCTraceResultSet(stmt.get(), connection.get(), end_time);
+
+	if (config->format != OUTPUT_TEXT)
+	{
+		// Records carry what the replay lines do, so they follow the replay option
+		if (!loop || config->replayLogging)
+			ODBCWriteStatementRecord(stmt.get(), end_time, config->format, config->recordLogging || config->replayLogging);
+	}
+	else
+	{
+		std::string text = std::regex_replace(stmt->statement, std::regex("\\r\\n|\\r|\\n"), " ");
+		if (!loop)
 		{
-			auto pos2 = cmdLine.find('\"', pos1 + 1);
-			if (pos2 > 0)
+			std::string output = std::to_string(ODBCProcessId()) + " ";
+			output.append(ODBCFormatNumber((end_time - stmt->begin_time) / 1000) + "ms ");
+
+			if (config->recordLogging)
 			{
-				cmdLine = cmdLine.substr(pos1 + 1, pos2);
+				output.append(ODBCFormatNumber(stmt->record_count) + " Recs ");
+				
+				if (option->total_output > 500000)
+				{
+					option->total_output = 0;
+					output.append("(" + ODBCFormatNumber(option->total_count) + " Total) ");
+				}
 			}
-		}
-		pos1 = cmdLine.find('\/');
-		if (pos1 > 0)
-		{
-			cmdLine = cmdLine.substr(0, pos1);
+			
+			output.append(text);
+			ODBCWriteLog(output);
 		}
 
-		std::transform(cmdLine.begin(), cmdLine.end(), cmdLine.begin(), ::tolower);
-		if (cmdLine.find("excel") != std::string::npos)
+		// Replay lines are never suppressed, odbcreplay needs every statement
+		if (config->replayLogging)
 		{
-			cmdLine = "excel";
+			ODBCWriteLog(std::to_string(ODBCProcessId()) + " replay " + connection->name() + " " +
+				std::to_string(stmt->begin_time) + " " + std::to_string(end_time - stmt->begin_time) + " " +
+				std::to_string(stmt->record_count) + " " + ODBCReplayEscape(stmt->statement));
 		}
+	}
+
+	if (!loop && config->breakdown_min > 0 && end_time - stmt->begin_time >= config->breakdown_min)
+		ODBCTraceBreakdown(stmt.get(), connection.get(), end_time - stmt->begin_time, cpu);
+
+	if (stmt->failed)
+		ODBCLogWriter::get()->statementFailed();
+	else if (config->repeat_window > 0 && stmt->begin_time > 0)
+		ODBCRepeatDetector::get()->statement(stmt->statement, stmt->begin_time, end_time, stmt->record_count, config->repeat_window);
+
+	ODBCTimeline::get()->statement(stmt.get(), end_time);
+
+	ODBCMetrics::get()->statement(stmt->fingerprint(), end_time - stmt->begin_time, stmt->record_count, stmt->failed, cpu);
+	ODBCMetrics::get()->statementClosed();
+	stmt->clear();
+}
 
-		char szProcName[MAX_PATH]; _splitpath(cmdLine.c_str(), NULL, NULL, szProcName, NULL);
-		char logtime[64]; _strtime(logtime);
-		fprintf(file, "%s %s %s\n", logtime, szProcName, log.c_str());
-		fclose(file);
+// "<pid> progress <connection> N Recs Xms R Recs/s (A Recs/s avg) <text>"
+// while a statement is still fetching: R since its last progress line, A
+// since it was executed.
+static void ODBCTraceProgress(ODBCStatementState *stmt, long long now)
+{
+	long long elapsed = now - stmt->begin_time;
+	long long since = now - stmt->progress_time;
+	long long current = since > 0 ? (stmt->record_count - stmt->progress_count) * 1000000LL / since : 0;
+	long long average = elapsed > 0 ? stmt->record_count * 1000000LL / elapsed : 0;
+	ODBCWriteLog(std::to_string(ODBCProcessId()) + " progress " + ODBCHandleTable::get()->connection(stmt->hdbc)->name() + " " +
+		ODBCFormatNumber(stmt->record_count) + " Recs " + ODBCFormatNumber(elapsed / 1000) + "ms " +
+		ODBCFormatNumber(current) + " Recs/s (" + ODBCFormatNumber(average) + " Recs/s avg) " + stmt->fingerprint().text);
+	stmt->progress_count = stmt->record_count;
+	stmt->progress_time = now;
+}
+
+// A statement was prepared or executed by the call, its state starts over.
+static void ODBCTraceStarted(ODBCStatementState *stmt, ODBCTraceCall *call, const std::string &text)
+{
+	if (stmt->statement == "")
+		ODBCMetrics::get()->statementOpened();
+	stmt->begin_time = call->begin_time;
+	stmt->progress_count = stmt->record_count;
+	stmt->progress_time = call->begin_time;
+	stmt->result_begin = call->begin_time;
+	stmt->result_records = stmt->record_count;
+	stmt->started(call->end_time - call->begin_time, call->thread_id);
+	stmt->failed = call->retcode == SQL_ERROR;
+	stmt->retcode = call->retcode;
+	stmt->statement = text;
+	const ODBCStatementFilter *filter = ODBCConfig::current()->filter.get();
+	stmt->excluded = filter != NULL &&
+		!filter->traced(stmt->statement, filter->usesDsn() ? ODBCHandleTable::get()->dsn(stmt->hdbc) : std::string());
+}
+
+// "<pid> cancel <connection> <function> Xms Cancel Yms Call <text>": the call
+// returned X after an SQLCancel of another thread entered, it ran for Y.
+void ODBCTraceCancelled(ODBCTraceCall *call)
+{
+	std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value, false);
+	if (stmt == NULL || stmt->excluded)
+		return;
+	long long latency = std::max(call->end_time - call->cancel_time, 0LL);
+	std::string output = std::to_string(ODBCProcessId()) + " cancel " + ODBCHandleTable::get()->connection(stmt->hdbc)->name() + " " +
+		call->function_name + " " + ODBCFormatNumber(latency / 1000) + "ms Cancel " +
+		ODBCFormatNumber((call->end_time - call->begin_time) / 1000) + "ms Call";
+	// Closing the cursor clears the statement
+	if (stmt->statement != "")
+	{
+		output.append(" " + stmt->fingerprint().text);
+		ODBCTimeouts::get()->cancelled(stmt->fingerprint(), latency);
 	}
+	ODBCWriteLog(output);
+}
+
+// "<pid> timeout <connection> <SQLSTATE> Xms <text>" the first time the
+// diagnostics of a statement report a timeout, X after it started.
+static void ODBCTraceTimeout(SQLHSTMT hstmt, const ODBCTraceArgument *sqlstate, long long now)
+{
+	std::string state = ODBCArgumentString(sqlstate, NULL).substr(0, 5);
+	if (state != "HYT00" && state != "HYT01")
+		return;
+	std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(hstmt, false);
+	if (stmt == NULL || stmt->statement == "" || stmt->excluded || stmt->timed_out)
+		return;
+	stmt->timed_out = true;
+	long long elapsed = now - stmt->begin_time;
+	ODBCWriteLog(std::to_string(ODBCProcessId()) + " timeout " + ODBCHandleTable::get()->connection(stmt->hdbc)->name() + " " +
+		state + " " + ODBCFormatNumber(elapsed / 1000) + "ms " + stmt->fingerprint().text);
+	ODBCTimeouts::get()->timedOut(stmt->fingerprint(), elapsed);
 }
 
 void ODBCTrace(ODBCTraceCall* call)
 {
 	ODBCTraceOptions* option = ODBCTraceOptions::get();
 
+	if (ODBCIsCatalogCall(call->function_id))
+	{
+		ODBCCatalogTrace(call);
+		return;
+	}
+
 	switch (call->function_id)
 	{
+	case SQL_API_SQLALLOCHANDLE:
+	case SQL_API_SQLALLOCSTMT:
+	case SQL_API_SQLDISCONNECT:
+	case SQL_API_SQLENDTRAN:
+	case SQL_API_SQLTRANSACT:
+	case SQL_API_SQLSETCONNECTATTR:
+	case SQL_API_SQLCONNECT:
+	case SQL_API_SQLDRIVERCONNECT:
+		ODBCHandleTrace(call);
+		return;
+	case SQL_API_SQLGETDATA:
+	{
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value, false);
+		if (stmt == NULL || stmt->statement == "" || stmt->excluded)
+			return;
+		stmt->driver_time += call->end_time - call->begin_time;
+		SQLLEN *length = (SQLLEN*)call->arguments[5].value;
+		if (!SQL_SUCCEEDED(call->retcode) || length == NULL || *length == SQL_NULL_DATA)
+			return;
+		// Truncated or of unknown length, the buffer is full
+		SQLLEN buffer = (SQLLEN)(intptr_t)call->arguments[4].value;
+		SQLLEN bytes = buffer > 0 && (*length == SQL_NO_TOTAL || *length > buffer) ? buffer : *length;
+		if (bytes > 0)
+			stmt->bytes += bytes;
+		return;
+	}
 	case SQL_API_SQLFETCH:
 	{
-		if (!option->recordLogging)
+		const ODBCConfig *config = ODBCConfig::current();
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value);
+		if (stmt->excluded)
 			return;
+		stmt->fetched(call->begin_time, call->end_time);
 
 		if (call->retcode == 0)
+			ODBCMetrics::get()->fetched();
+		else if (call->retcode == SQL_ERROR)
 		{
-			option->record_count++;
+			stmt->failed = true;
+			stmt->retcode = SQL_ERROR;
+		}
+
+		if (!config->recordLogging && !config->replayLogging)
+			return;
+
+		if (call->retcode == 0)
+		{
+			stmt->record_count++;
 			option->total_count++;
 			option->total_output++;
+			// Statements executed before the log was opened have no start
+			if (stmt->progress_time > 0 &&
+				((config->progress_rows > 0 && stmt->record_count - stmt->progress_count >= config->progress_rows) ||
+				(config->progress_interval > 0 && call->end_time - stmt->progress_time >= config->progress_interval)))
+				ODBCTraceProgress(stmt.get(), call->end_time);
 		}
 		
 		return;
 	}
-	case SQL_API_SQLFREESTMT:
+	case SQL_API_SQLFREEHANDLE:
+	{
+		if ((SQLSMALLINT)(intptr_t)call->arguments[0].value == SQL_HANDLE_STMT)
+			ODBCTraceStatement(call->arguments[1].value, call);
+		ODBCHandleTrace(call);
+		return;
+	}
 	case SQL_API_SQLMORERESULTS:
-	case SQL_API_SQLCLOSECURSOR:
 	{
-		if (option->statement == "")
-			return;
-
-		std::string output = std::to_string(GetCurrentProcessId()) + " ";
-		std::string number_str = std::to_string(clock() - option->begin_time);
-		for (int i = number_str.length() - 3; i > 0; i -= 3)
-			number_str.insert(i, ",");
-		output.append(number_str + "ms ");
-
-		if (option->recordLogging)
+		// Another result set follows, the statement stays open and its
+		// records are counted to the next one
+		if (!SQL_SUCCEEDED(call->retcode))
 		{
-			number_str = std::to_string(option->record_count);			
-			for (int i = number_str.length() - 3; i > 0; i -= 3)
-				number_str.insert(i, ",");
-			output.append(number_str + " Recs ");
-			option->record_count = 0;
-			
-			if (option->total_output > 500000)
-			{
-				option->total_output = 0;
-				number_str = std::to_string(option->total_count);
-				
-				for (int i = number_str.length() - 3; i > 0; i -= 3)
-					number_str.insert(i, ",");
-
-				output.append("(" + number_str + " Total) ");
-			}
+			ODBCTraceStatement(call->arguments[0].value, call);
+			return;
 		}
-		
-		output.append(std::regex_replace(option->statement, std::regex("\\r\\n|\\r|\\n"), " "));
-		ODBCWriteLog(output);
-
-		break;
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value, false);
+		if (stmt == NULL || stmt->statement == "" || stmt->excluded)
+			return;
+		stmt->driver_time += call->end_time - call->begin_time;
+		ODBCTraceResultSet(stmt.get(), ODBCHandleTable::get()->connection(stmt->hdbc).get(), call->begin_time);
+		return;
 	}
-	case SQL_API_SQLPREPARE:
-	{		
-		for (int i = 0; i < call->arguments_count; i++)
+	case SQL_API_SQLCANCEL:
+	{
+		// The calls it interrupted write their lines when they return. Finding
+		// none does not make the statement idle, it may be running a call that
+		// is not hooked, as SQLExtendedFetch, SQLFetchScroll or SQLParamData,
+		// so the SQLCancel is neither paired nor counted.
+		if (call->cancel_targets > 0)
+			return;
+		// A handle the table does not know gets no state here
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value, false);
+		ODBCWriteLog(std::to_string(ODBCProcessId()) + " cancel " + ODBCConnectionState::name(stmt ? stmt->hdbc : NULL) +
+			" SQLCancel " + ODBCFormatNumber((call->end_time - call->begin_time) / 1000) + "ms No Traced Call");
+		return;
+	}
+	case SQL_API_SQLGETDIAGREC:
+	{
+		if ((SQLSMALLINT)(intptr_t)call->arguments[0].value == SQL_HANDLE_STMT && SQL_SUCCEEDED(call->retcode))
+			ODBCTraceTimeout(call->arguments[1].value, &call->arguments[3], call->end_time);
+		return;
+	}
+	case SQL_API_SQLERROR:
+	{
+		if (call->arguments[2].value != NULL && SQL_SUCCEEDED(call->retcode))
+			ODBCTraceTimeout(call->arguments[2].value, &call->arguments[3], call->end_time);
+		return;
+	}
+	case SQL_API_SQLROWCOUNT:
+	{
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value, false);
+		if (stmt == NULL || stmt->statement == "" || stmt->excluded)
+			return;
+		stmt->driver_time += call->end_time - call->begin_time;
+		SQLLEN *rows = (SQLLEN*)call->arguments[1].value;
+		if (SQL_SUCCEEDED(call->retcode) && rows != NULL)
+			stmt->row_count = *rows;
+		return;
+	}
+	case SQL_API_SQLFREESTMT:
+	case SQL_API_SQLCLOSECURSOR:
+	{
+		ODBCTraceStatement(call->arguments[0].value, call);
+		if (call->function_id == SQL_API_SQLFREESTMT)
+			ODBCHandleTrace(call);
+		return;
+	}
+	case SQL_API_SQLEXECUTE:
+	{
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value);
+		// Executed again after its cursor was closed, a new statement starts
+		if (stmt->statement == "")
 		{
-			ODBCTraceArgument* arg = &call->arguments[i];
-			if (arg->type == TYP_SQLCHAR_PTR && arg->value)
-			{
-				option->begin_time = clock();
-				option->statement = (char*)arg->value;
-				return;
-			}
+			if (stmt->prepared != "")
+				ODBCTraceStarted(stmt.get(), call, stmt->prepared);
+			return;
 		}
-		
-		break;
+		if (stmt->excluded)
+			return;
+		// The server runs the statement in the call, and the first fetch of
+		// its result follows the call rather than a fetch before it
+		stmt->driver_time += call->end_time - call->begin_time;
+		stmt->last_fetch = 0;
+		if (call->retcode == SQL_ERROR)
+		{
+			stmt->failed = true;
+			stmt->retcode = SQL_ERROR;
+		}
+		return;
 	}
+	case SQL_API_SQLPREPARE:
 	case SQL_API_SQLEXECDIRECT:
 	{
+		std::shared_ptr<ODBCStatementState> stmt = ODBCHandleTable::get()->statement(call->arguments[0].value);
 		for (int i = 0; i < call->arguments_count; i++)
 		{
 			ODBCTraceArgument* arg = &call->arguments[i];
-			if (arg->type == TYP_SQLWCHAR_PTR && arg->value)
+			if ((arg->type == TYP_SQLCHAR_PTR || arg->type == TYP_SQLWCHAR_PTR) && arg->value)
 			{
-				std::wstring ws((SQLWCHAR*)arg->value);
-				std::string str(ws.begin(), ws.end());
-				option->begin_time = clock();
-				option->statement = str;
+				std::string text = ODBCArgumentString(arg, &call->arguments[i + 1]);
+				// Executing another statement discards the prepared one
+				stmt->prepared = call->function_id == SQL_API_SQLPREPARE && call->retcode != SQL_ERROR ? text : std::string();
+				ODBCTraceStarted(stmt.get(), call, text);
+				if (call->function_id == SQL_API_SQLEXECDIRECT && SQL_SUCCEEDED(call->retcode) && !stmt->excluded)
+					ODBCPrepareAdvisor::get()->executed(stmt->fingerprint(), stmt->statement, call->end_time - call->begin_time);
 				return;
 			}
 		}
-		break;
+		if (stmt->statement != "")
+			ODBCMetrics::get()->statementClosed();
+		stmt->statement = "";
+		stmt->prepared = "";
+		stmt->excluded = false;
+		return;
 	}
 	}	
-
-	option->statement = "";
 }
 
+extern "C" {
+
 RETCODE SQL_API TraceSQLFetch(SQLHSTMT hstmt)
 {
 	ODBCTraceCall *call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
 	call->function_id = SQL_API_SQLFETCH;
+	call->function_name = "SQLFetch";
 	return (RETCODE)stack.push(call);
 }
 
@@ -253,8 +823,9 @@ RETCODE SQL_API TraceSQLFreeStmt(SQLHSTMT hstmt, SQLUSMALLINT fOption)
 {
 	ODBCTraceCall* call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-	call->insertArgument("fOption", TYP_SQLUSMALLINT, (void*)fOption);
+	call->insertArgument("fOption", TYP_SQLUSMALLINT, (void*)(intptr_t)fOption);
 	call->function_id = SQL_API_SQLFREESTMT;
+	call->function_name = "SQLFreeStmt";
 	return (RETCODE)stack.push(call);
 }
 
@@ -263,6 +834,7 @@ RETCODE SQL_API TraceSQLMoreResults(SQLHSTMT  hstmt)
 	ODBCTraceCall *call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
 	call->function_id = SQL_API_SQLMORERESULTS;
+	call->function_name = "SQLMoreResults";
 	return (RETCODE)stack.push(call);
 }
 
@@ -271,8 +843,9 @@ RETCODE SQL_API TraceSQLPrepare(SQLHSTMT hstmt, SQLCHAR FAR* szSqlStr, SQLINTEGE
 	ODBCTraceCall* call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
 	call->insertArgument("szSqlStr", TYP_SQLCHAR_PTR, szSqlStr);
-	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)cbSqlStr);
+	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)(intptr_t)cbSqlStr);
 	call->function_id = SQL_API_SQLPREPARE;
+	call->function_name = "SQLPrepare";
 	return (RETCODE)stack.push(call);
 }
 
@@ -281,8 +854,9 @@ RETCODE SQL_API TraceSQLPrepareW(SQLHSTMT hstmt,SQLWCHAR FAR *szSqlStr,SQLINTEGE
 	ODBCTraceCall *call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
 	call->insertArgument("szSqlStr", TYP_SQLWCHAR_PTR, szSqlStr);
-	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)cbSqlStr);
+	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)(intptr_t)cbSqlStr);
 	call->function_id = SQL_API_SQLPREPARE;
+	call->function_name = "SQLPrepareW";
 	return (RETCODE)stack.push(call);
 }
 
@@ -291,8 +865,9 @@ RETCODE SQL_API TraceSQLExecDirect(SQLHSTMT hstmt, SQLCHAR FAR *szSqlStr, SQLINT
 	ODBCTraceCall *call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
 	call->insertArgument("szSqlStr", TYP_SQLCHAR_PTR, szSqlStr);
-	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)cbSqlStr);
+	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)(intptr_t)cbSqlStr);
 	call->function_id = SQL_API_SQLEXECDIRECT;
+	call->function_name = "SQLExecDirect";
 	return (RETCODE)stack.push(call);
 }
 
@@ -301,8 +876,9 @@ RETCODE SQL_API TraceSQLExecDirectW(SQLHSTMT hstmt, SQLWCHAR FAR *szSqlStr, SQLI
 	ODBCTraceCall *call = new ODBCTraceCall();
 	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
 	call->insertArgument("szSqlStr", TYP_SQLWCHAR_PTR, szSqlStr);
-	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)cbSqlStr);
+	call->insertArgument("cbSqlStr", TYP_SQLINTEGER, (void*)(intptr_t)cbSqlStr);
 	call->function_id = SQL_API_SQLEXECDIRECT;
+	call->function_name = "SQLExecDirectW";
 	return (RETCODE)stack.push(call);
 }
 
@@ -311,129 +887,151 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 	ODBCTraceCall *call = new ODBCTraceCall();
 	call->insertArgument("Handle", TYP_SQLHSTMT, Handle);
 	call->function_id = SQL_API_SQLCLOSECURSOR;
+	call->function_name = "SQLCloseCursor";
 	return (RETCODE)stack.push(call);
 }
 
-//RETCODE SQL_API TraceSQLTables(SQLHSTMT hstmt, SQLCHAR FAR *CatalogName, SQLSMALLINT NameLength1,
-//											   SQLCHAR FAR *SchemaName,SQLSMALLINT NameLength2,
-//											   SQLCHAR FAR *TableName,SQLSMALLINT NameLength3,
-//											   SQLCHAR FAR *TableType,SQLSMALLINT NameLength4)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("CatalogName", TYP_SQLCHAR_PTR, CatalogName);
-//	call->insertArgument("NameLength1", TYP_SQLSMALLINT, (void*)NameLength1);
-//	call->insertArgument("SchemaName", TYP_SQLCHAR_PTR, SchemaName);
-//	call->insertArgument("NameLength2", TYP_SQLSMALLINT, (void*)NameLength2);
-//	call->insertArgument("TableName", TYP_SQLCHAR_PTR, TableName);
-//	call->insertArgument("NameLength3", TYP_SQLSMALLINT, (void*)NameLength3);
-//	call->insertArgument("TableType", TYP_SQLCHAR_PTR, TableType);
-//	call->insertArgument("NameLength4", TYP_SQLSMALLINT, (void*)NameLength4);
-//
-//	call->function_id = SQL_API_SQLTABLES;
-//	call->function_name = "SQLTables";
-//
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLTablesW(SQLHSTMT hstmt, SQLWCHAR FAR *CatalogName, SQLSMALLINT NameLength1,
-//											   SQLWCHAR FAR *SchemaName,SQLSMALLINT NameLength2,
-//											   SQLWCHAR FAR *TableName,SQLSMALLINT NameLength3,
-//											   SQLWCHAR FAR *TableType,SQLSMALLINT NameLength4)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("CatalogName", TYP_SQLWCHAR_PTR, CatalogName);
-//	call->insertArgument("NameLength1", TYP_SQLSMALLINT, (void*)NameLength1);
-//	call->insertArgument("SchemaName", TYP_SQLWCHAR_PTR, SchemaName);
-//	call->insertArgument("NameLength2", TYP_SQLSMALLINT, (void*)NameLength2);
-//	call->insertArgument("TableName", TYP_SQLWCHAR_PTR, TableName);
-//	call->insertArgument("NameLength3", TYP_SQLSMALLINT, (void*)NameLength3);
-//	call->insertArgument("TableType", TYP_SQLWCHAR_PTR, TableType);
-//	call->insertArgument("NameLength4", TYP_SQLSMALLINT, (void*)NameLength4);
-//
-//	call->unicode = true;
-//	call->function_id = SQL_API_SQLTABLES;
-//	call->function_name = "SQLTablesW";
-//
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLColumns(SQLHSTMT hstmt,	SQLCHAR FAR *CatalogName,SQLSMALLINT CatLength,
-//												SQLCHAR FAR *SchemaName,SQLSMALLINT SchLength,
-//												SQLCHAR FAR *TableName, SQLSMALLINT TabLength,
-//												SQLCHAR FAR *ColumnName,SQLSMALLINT ColLength)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("CatalogName", TYP_SQLCHAR_PTR, CatalogName);
-//	call->insertArgument("CatLength", TYP_SQLSMALLINT, (void*)CatLength);
-//	call->insertArgument("SchemaName", TYP_SQLCHAR_PTR, SchemaName);
-//	call->insertArgument("SchLength", TYP_SQLSMALLINT, (void*)SchLength);
-//	call->insertArgument("TableName", TYP_SQLCHAR_PTR, TableName);
-//	call->insertArgument("TabLength", TYP_SQLSMALLINT, (void*)TabLength);
-//	call->insertArgument("ColumnName", TYP_SQLCHAR_PTR, ColumnName);
-//	call->insertArgument("ColLength", TYP_SQLSMALLINT, (void*)ColLength);
-//
-//	call->function_name = "SQLColumns";
-//	call->function_id = SQL_API_SQLCOLUMNS;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLStatistics(SQLHSTMT hstmt,SQLCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
-//												  SQLCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
-//												  SQLCHAR FAR *szTableName,SQLSMALLINT cbTableName,
-//												  SQLUSMALLINT fUnique,SQLUSMALLINT fAccuracy)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("szTableQualifier", TYP_SQLCHAR_PTR, szTableQualifier);
-//	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)cbTableQualifier);
-//	call->insertArgument("szTableOwner", TYP_SQLCHAR_PTR, szTableOwner);
-//	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)cbTableOwner);
-//	call->insertArgument("szTableName", TYP_SQLCHAR_PTR, szTableName);
-//	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)cbTableName);
-//	call->insertArgument("fUnique", TYP_SQLUSMALLINT, (void*)fUnique);
-//	call->insertArgument("fAccuracy", TYP_SQLUSMALLINT, (void*)fAccuracy);
-//
-//	call->function_name = "SQLStatistics";
-//	call->function_id = SQL_API_SQLSTATISTICS;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLStatisticsW(SQLHSTMT hstmt,SQLWCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
-//												  SQLWCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
-//												  SQLWCHAR FAR *szTableName,SQLSMALLINT cbTableName,
-//												  SQLUSMALLINT fUnique,SQLUSMALLINT fAccuracy)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("szTableQualifier", TYP_SQLWCHAR_PTR, szTableQualifier);
-//	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)cbTableQualifier);
-//	call->insertArgument("szTableOwner", TYP_SQLWCHAR_PTR, szTableOwner);
-//	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)cbTableOwner);
-//	call->insertArgument("szTableName", TYP_SQLWCHAR_PTR, szTableName);
-//	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)cbTableName);
-//	call->insertArgument("fUnique", TYP_SQLUSMALLINT, (void*)fUnique);
-//	call->insertArgument("fAccuracy", TYP_SQLUSMALLINT, (void*)fAccuracy);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLStatisticsW";
-//	call->function_id = SQL_API_SQLSTATISTICS;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLTables(SQLHSTMT hstmt, SQLCHAR FAR *CatalogName, SQLSMALLINT NameLength1,
+											   SQLCHAR FAR *SchemaName,SQLSMALLINT NameLength2,
+											   SQLCHAR FAR *TableName,SQLSMALLINT NameLength3,
+											   SQLCHAR FAR *TableType,SQLSMALLINT NameLength4)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("CatalogName", TYP_SQLCHAR_PTR, CatalogName);
+	call->insertArgument("NameLength1", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength1);
+	call->insertArgument("SchemaName", TYP_SQLCHAR_PTR, SchemaName);
+	call->insertArgument("NameLength2", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength2);
+	call->insertArgument("TableName", TYP_SQLCHAR_PTR, TableName);
+	call->insertArgument("NameLength3", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength3);
+	call->insertArgument("TableType", TYP_SQLCHAR_PTR, TableType);
+	call->insertArgument("NameLength4", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength4);
+
+	call->function_id = SQL_API_SQLTABLES;
+	call->function_name = "SQLTables";
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLTablesW(SQLHSTMT hstmt, SQLWCHAR FAR *CatalogName, SQLSMALLINT NameLength1,
+											   SQLWCHAR FAR *SchemaName,SQLSMALLINT NameLength2,
+											   SQLWCHAR FAR *TableName,SQLSMALLINT NameLength3,
+											   SQLWCHAR FAR *TableType,SQLSMALLINT NameLength4)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("CatalogName", TYP_SQLWCHAR_PTR, CatalogName);
+	call->insertArgument("NameLength1", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength1);
+	call->insertArgument("SchemaName", TYP_SQLWCHAR_PTR, SchemaName);
+	call->insertArgument("NameLength2", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength2);
+	call->insertArgument("TableName", TYP_SQLWCHAR_PTR, TableName);
+	call->insertArgument("NameLength3", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength3);
+	call->insertArgument("TableType", TYP_SQLWCHAR_PTR, TableType);
+	call->insertArgument("NameLength4", TYP_SQLSMALLINT, (void*)(intptr_t)NameLength4);
+
+	call->unicode = true;
+	call->function_id = SQL_API_SQLTABLES;
+	call->function_name = "SQLTablesW";
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLColumns(SQLHSTMT hstmt,	SQLCHAR FAR *CatalogName,SQLSMALLINT CatLength,
+												SQLCHAR FAR *SchemaName,SQLSMALLINT SchLength,
+												SQLCHAR FAR *TableName, SQLSMALLINT TabLength,
+												SQLCHAR FAR *ColumnName,SQLSMALLINT ColLength)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("CatalogName", TYP_SQLCHAR_PTR, CatalogName);
+	call->insertArgument("CatLength", TYP_SQLSMALLINT, (void*)(intptr_t)CatLength);
+	call->insertArgument("SchemaName", TYP_SQLCHAR_PTR, SchemaName);
+	call->insertArgument("SchLength", TYP_SQLSMALLINT, (void*)(intptr_t)SchLength);
+	call->insertArgument("TableName", TYP_SQLCHAR_PTR, TableName);
+	call->insertArgument("TabLength", TYP_SQLSMALLINT, (void*)(intptr_t)TabLength);
+	call->insertArgument("ColumnName", TYP_SQLCHAR_PTR, ColumnName);
+	call->insertArgument("ColLength", TYP_SQLSMALLINT, (void*)(intptr_t)ColLength);
+
+	call->function_name = "SQLColumns";
+	call->function_id = SQL_API_SQLCOLUMNS;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLColumnsW(SQLHSTMT hstmt,	SQLWCHAR FAR *CatalogName,SQLSMALLINT CatLength,
+												SQLWCHAR FAR *SchemaName,SQLSMALLINT SchLength,
+												SQLWCHAR FAR *TableName, SQLSMALLINT TabLength,
+												SQLWCHAR FAR *ColumnName,SQLSMALLINT ColLength)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("CatalogName", TYP_SQLWCHAR_PTR, CatalogName);
+	call->insertArgument("CatLength", TYP_SQLSMALLINT, (void*)(intptr_t)CatLength);
+	call->insertArgument("SchemaName", TYP_SQLWCHAR_PTR, SchemaName);
+	call->insertArgument("SchLength", TYP_SQLSMALLINT, (void*)(intptr_t)SchLength);
+	call->insertArgument("TableName", TYP_SQLWCHAR_PTR, TableName);
+	call->insertArgument("TabLength", TYP_SQLSMALLINT, (void*)(intptr_t)TabLength);
+	call->insertArgument("ColumnName", TYP_SQLWCHAR_PTR, ColumnName);
+	call->insertArgument("ColLength", TYP_SQLSMALLINT, (void*)(intptr_t)ColLength);
+
+	call->unicode = true;
+	call->function_name = "SQLColumnsW";
+	call->function_id = SQL_API_SQLCOLUMNS;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLStatistics(SQLHSTMT hstmt,SQLCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
+												  SQLCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
+												  SQLCHAR FAR *szTableName,SQLSMALLINT cbTableName,
+												  SQLUSMALLINT fUnique,SQLUSMALLINT fAccuracy)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("szTableQualifier", TYP_SQLCHAR_PTR, szTableQualifier);
+	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableQualifier);
+	call->insertArgument("szTableOwner", TYP_SQLCHAR_PTR, szTableOwner);
+	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableOwner);
+	call->insertArgument("szTableName", TYP_SQLCHAR_PTR, szTableName);
+	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableName);
+	call->insertArgument("fUnique", TYP_SQLUSMALLINT, (void*)(intptr_t)fUnique);
+	call->insertArgument("fAccuracy", TYP_SQLUSMALLINT, (void*)(intptr_t)fAccuracy);
+
+	call->function_name = "SQLStatistics";
+	call->function_id = SQL_API_SQLSTATISTICS;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLStatisticsW(SQLHSTMT hstmt,SQLWCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
+												  SQLWCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
+												  SQLWCHAR FAR *szTableName,SQLSMALLINT cbTableName,
+												  SQLUSMALLINT fUnique,SQLUSMALLINT fAccuracy)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("szTableQualifier", TYP_SQLWCHAR_PTR, szTableQualifier);
+	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableQualifier);
+	call->insertArgument("szTableOwner", TYP_SQLWCHAR_PTR, szTableOwner);
+	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableOwner);
+	call->insertArgument("szTableName", TYP_SQLWCHAR_PTR, szTableName);
+	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableName);
+	call->insertArgument("fUnique", TYP_SQLUSMALLINT, (void*)(intptr_t)fUnique);
+	call->insertArgument("fAccuracy", TYP_SQLUSMALLINT, (void*)(intptr_t)fAccuracy);
+
+	call->unicode = true;
+	call->function_name = "SQLStatisticsW";
+	call->function_id = SQL_API_SQLSTATISTICS;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLTablePrivileges(SQLHSTMT hstmt,	SQLCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
 //														SQLCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
 //														SQLCHAR FAR *szTableName,SQLSMALLINT cbTableName)
@@ -544,59 +1142,57 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	call->insertArgument("szTableName", TYP_SQLWCHAR_PTR, szTableName);
 //	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)cbTableName);
 //	call->insertArgument("fScope", TYP_SQLUSMALLINT, (void*)fScope);
-//	call->insertArgument("fNullable", TYP_SQLUSMALLINT, (void*)fNullable);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLSpecialColumnsW";
-//	call->function_id = SQL_API_SQLSPECIALCOLUMNS;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLPrimaryKeys(SQLHSTMT hstmt,SQLCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
-//									SQLCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
-//									SQLCHAR FAR *szTableName,SQLSMALLINT cbTableName)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("szTableQualifier", TYP_SQLCHAR_PTR, szTableQualifier);
-//	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)cbTableQualifier);
-//	call->insertArgument("szTableOwner", TYP_SQLCHAR_PTR, szTableOwner);
-//	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)cbTableOwner);
-//	call->insertArgument("szTableName", TYP_SQLCHAR_PTR, szTableName);
-//	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)cbTableName);
-//
-//	call->function_name = "SQLPrimaryKeys";
-//	call->function_id = SQL_API_SQLPRIMARYKEYS;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLPrimaryKeysW(SQLHSTMT hstmt,SQLWCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
-//									SQLWCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
-//									SQLWCHAR FAR *szTableName,SQLSMALLINT cbTableName)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("szTableQualifier", TYP_SQLWCHAR_PTR, szTableQualifier);
-//	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)cbTableQualifier);
-//	call->insertArgument("szTableOwner", TYP_SQLWCHAR_PTR, szTableOwner);
-//	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)cbTableOwner);
-//	call->insertArgument("szTableName", TYP_SQLWCHAR_PTR, szTableName);
-//	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)cbTableName);
+//	call->insertArgument("fNullable", TYP_SQLUSMALLINT, (void*)fNullable);
 //
 //	call->unicode = true;
-//	call->function_name = "SQLPrimaryKeysW";
-//	call->function_id = SQL_API_SQLPRIMARYKEYS;
+//	call->function_name = "SQLSpecialColumnsW";
+//	call->function_id = SQL_API_SQLSPECIALCOLUMNS;
 //
 //	ODBCTrace(call, true);
 //	return (RETCODE)stack.push(call);
 //
 //}
+RETCODE SQL_API TraceSQLPrimaryKeys(SQLHSTMT hstmt,SQLCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
+									SQLCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
+									SQLCHAR FAR *szTableName,SQLSMALLINT cbTableName)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("szTableQualifier", TYP_SQLCHAR_PTR, szTableQualifier);
+	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableQualifier);
+	call->insertArgument("szTableOwner", TYP_SQLCHAR_PTR, szTableOwner);
+	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableOwner);
+	call->insertArgument("szTableName", TYP_SQLCHAR_PTR, szTableName);
+	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableName);
+
+	call->function_name = "SQLPrimaryKeys";
+	call->function_id = SQL_API_SQLPRIMARYKEYS;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLPrimaryKeysW(SQLHSTMT hstmt,SQLWCHAR FAR *szTableQualifier,SQLSMALLINT cbTableQualifier,
+									SQLWCHAR FAR *szTableOwner,SQLSMALLINT cbTableOwner,
+									SQLWCHAR FAR *szTableName,SQLSMALLINT cbTableName)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("szTableQualifier", TYP_SQLWCHAR_PTR, szTableQualifier);
+	call->insertArgument("cbTableQualifier", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableQualifier);
+	call->insertArgument("szTableOwner", TYP_SQLWCHAR_PTR, szTableOwner);
+	call->insertArgument("cbTableOwner", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableOwner);
+	call->insertArgument("szTableName", TYP_SQLWCHAR_PTR, szTableName);
+	call->insertArgument("cbTableName", TYP_SQLSMALLINT, (void*)(intptr_t)cbTableName);
+
+	call->unicode = true;
+	call->function_name = "SQLPrimaryKeysW";
+	call->function_id = SQL_API_SQLPRIMARYKEYS;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLForeignKeys(SQLHSTMT hstmt,	SQLCHAR FAR *szPkTableQualifier,SQLSMALLINT cbPkTableQualifier,
 //													SQLCHAR FAR *szPkTableOwner,SQLSMALLINT cbPkTableOwner,
 //													SQLCHAR FAR *szPkTableName,SQLSMALLINT cbPkTableName,
@@ -694,76 +1290,94 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLConnect(SQLHDBC hdbc,	SQLCHAR FAR *szDSN,SQLSMALLINT	 cbDSN,
-//												SQLCHAR FAR *szUID, SQLSMALLINT cbUID,
-//												SQLCHAR FAR *szAuthStr, SQLSMALLINT cbAuthStr)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("szDSN", TYP_SQLCHAR_PTR, szDSN);
-//	call->insertArgument("cbDSN", TYP_SQLSMALLINT, (void*)cbDSN);
-//	call->insertArgument("szUID", TYP_SQLCHAR_PTR, szUID);
-//	call->insertArgument("cbUID", TYP_SQLSMALLINT, (void*)cbUID);
-//	call->insertArgument("szAuthStr", TYP_SQLCHAR_PTR, szAuthStr);
-//	call->insertArgument("cbAuthStr", TYP_SQLSMALLINT, (void*)cbAuthStr);
-//
-//	call->function_name = "SQLConnect";
-//	call->function_id = SQL_API_SQLCONNECT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLDriverConnect(SQLHDBC hdbc,SQLHWND hwnd,
-//												SQLCHAR FAR *szConnStrIn,SQLSMALLINT cbConnStrIn,
-//												SQLCHAR FAR *szConnStrOut,SQLSMALLINT cbConnStrOutMax,
-//												SQLSMALLINT FAR *pcbConnStrOut,
-//												SQLUSMALLINT fDriverCompletion)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("hwnd", TYP_SQLHWND, hwnd);
-//	call->insertArgument("szConnStrIn", TYP_SQLCHAR_PTR, szConnStrIn);
-//	call->insertArgument("cbConnStrIn", TYP_SQLSMALLINT, (void*)cbConnStrIn);
-//	call->insertArgument("szConnStrOut", TYP_SQLCHAR_PTR, szConnStrOut);
-//	call->insertArgument("cbConnStrOutMax", TYP_SQLSMALLINT, (void*)cbConnStrOutMax);
-//	call->insertArgument("pcbConnStrOut", TYP_SQLSMALLINT_PTR, pcbConnStrOut);
-//	call->insertArgument("fDriverCompletion", TYP_SQLSMALLINT, (void*)fDriverCompletion);
-//
-//	call->function_name = "SQLDriverConnect";
-//	call->function_id = SQL_API_SQLDRIVERCONNECT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLDriverConnectW(SQLHDBC hdbc,SQLHWND hwnd,
-//												SQLWCHAR FAR *szConnStrIn,SQLSMALLINT cbConnStrIn,
-//												SQLWCHAR FAR *szConnStrOut,SQLSMALLINT cbConnStrOutMax,
-//												SQLSMALLINT FAR *pcbConnStrOut,
-//												SQLUSMALLINT fDriverCompletion)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("hwnd", TYP_SQLHWND, hwnd);
-//	call->insertArgument("szConnStrIn", TYP_SQLWCHAR_PTR, szConnStrIn);
-//	call->insertArgument("cbConnStrIn", TYP_SQLSMALLINT, (void*)cbConnStrIn);
-//	call->insertArgument("szConnStrOut", TYP_SQLWCHAR_PTR, szConnStrOut);
-//	call->insertArgument("cbConnStrOutMax", TYP_SQLSMALLINT, (void*)cbConnStrOutMax);
-//	call->insertArgument("pcbConnStrOut", TYP_SQLSMALLINT_PTR, pcbConnStrOut);
-//	call->insertArgument("fDriverCompletion", TYP_SQLSMALLINT, (void*)fDriverCompletion);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLDriverConnectW";
-//	call->function_id = SQL_API_SQLDRIVERCONNECT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLConnect(SQLHDBC hdbc,	SQLCHAR FAR *szDSN,SQLSMALLINT	 cbDSN,
+												SQLCHAR FAR *szUID, SQLSMALLINT cbUID,
+												SQLCHAR FAR *szAuthStr, SQLSMALLINT cbAuthStr)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("szDSN", TYP_SQLCHAR_PTR, szDSN);
+	call->insertArgument("cbDSN", TYP_SQLSMALLINT, (void*)(intptr_t)cbDSN);
+	call->insertArgument("szUID", TYP_SQLCHAR_PTR, szUID);
+	call->insertArgument("cbUID", TYP_SQLSMALLINT, (void*)(intptr_t)cbUID);
+	call->insertArgument("szAuthStr", TYP_SQLCHAR_PTR, szAuthStr);
+	call->insertArgument("cbAuthStr", TYP_SQLSMALLINT, (void*)(intptr_t)cbAuthStr);
+
+	call->function_name = "SQLConnect";
+	call->function_id = SQL_API_SQLCONNECT;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLConnectW(SQLHDBC hdbc,	SQLWCHAR FAR *szDSN,SQLSMALLINT	 cbDSN,
+												SQLWCHAR FAR *szUID, SQLSMALLINT cbUID,
+												SQLWCHAR FAR *szAuthStr, SQLSMALLINT cbAuthStr)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("szDSN", TYP_SQLWCHAR_PTR, szDSN);
+	call->insertArgument("cbDSN", TYP_SQLSMALLINT, (void*)(intptr_t)cbDSN);
+	call->insertArgument("szUID", TYP_SQLWCHAR_PTR, szUID);
+	call->insertArgument("cbUID", TYP_SQLSMALLINT, (void*)(intptr_t)cbUID);
+	call->insertArgument("szAuthStr", TYP_SQLWCHAR_PTR, szAuthStr);
+	call->insertArgument("cbAuthStr", TYP_SQLSMALLINT, (void*)(intptr_t)cbAuthStr);
+
+	call->unicode = true;
+	call->function_name = "SQLConnectW";
+	call->function_id = SQL_API_SQLCONNECT;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLDriverConnect(SQLHDBC hdbc,SQLHWND hwnd,
+												SQLCHAR FAR *szConnStrIn,SQLSMALLINT cbConnStrIn,
+												SQLCHAR FAR *szConnStrOut,SQLSMALLINT cbConnStrOutMax,
+												SQLSMALLINT FAR *pcbConnStrOut,
+												SQLUSMALLINT fDriverCompletion)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("hwnd", TYP_SQLHWND, hwnd);
+	call->insertArgument("szConnStrIn", TYP_SQLCHAR_PTR, szConnStrIn);
+	call->insertArgument("cbConnStrIn", TYP_SQLSMALLINT, (void*)(intptr_t)cbConnStrIn);
+	call->insertArgument("szConnStrOut", TYP_SQLCHAR_PTR, szConnStrOut);
+	call->insertArgument("cbConnStrOutMax", TYP_SQLSMALLINT, (void*)(intptr_t)cbConnStrOutMax);
+	call->insertArgument("pcbConnStrOut", TYP_SQLSMALLINT_PTR, pcbConnStrOut);
+	call->insertArgument("fDriverCompletion", TYP_SQLSMALLINT, (void*)(intptr_t)fDriverCompletion);
+
+	call->function_name = "SQLDriverConnect";
+	call->function_id = SQL_API_SQLDRIVERCONNECT;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLDriverConnectW(SQLHDBC hdbc,SQLHWND hwnd,
+												SQLWCHAR FAR *szConnStrIn,SQLSMALLINT cbConnStrIn,
+												SQLWCHAR FAR *szConnStrOut,SQLSMALLINT cbConnStrOutMax,
+												SQLSMALLINT FAR *pcbConnStrOut,
+												SQLUSMALLINT fDriverCompletion)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("hwnd", TYP_SQLHWND, hwnd);
+	call->insertArgument("szConnStrIn", TYP_SQLWCHAR_PTR, szConnStrIn);
+	call->insertArgument("cbConnStrIn", TYP_SQLSMALLINT, (void*)(intptr_t)cbConnStrIn);
+	call->insertArgument("szConnStrOut", TYP_SQLWCHAR_PTR, szConnStrOut);
+	call->insertArgument("cbConnStrOutMax", TYP_SQLSMALLINT, (void*)(intptr_t)cbConnStrOutMax);
+	call->insertArgument("pcbConnStrOut", TYP_SQLSMALLINT_PTR, pcbConnStrOut);
+	call->insertArgument("fDriverCompletion", TYP_SQLSMALLINT, (void*)(intptr_t)fDriverCompletion);
+
+	call->unicode = true;
+	call->function_name = "SQLDriverConnectW";
+	call->function_id = SQL_API_SQLDRIVERCONNECT;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLBrowseConnect(SQLHDBC hdbc,	SQLCHAR FAR *szConnStrIn,SQLSMALLINT cbConnStrIn,
 //													SQLCHAR FAR *szConnStrOut,SQLSMALLINT cbConnStrOutMax,
 //													SQLSMALLINT FAR *pcbConnStrOut)
@@ -808,49 +1422,46 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //}
 //
 //
-//RETCODE SQL_API TraceSQLDisconnect(SQLHDBC hdbc)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//
-//	call->function_name = "SQLDisconnect";
-//	call->function_id = SQL_API_SQLDISCONNECT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLEndTran(SQLSMALLINT HandleType,SQLHANDLE   Handle,SQLSMALLINT CompletionType)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)HandleType);
-//	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
-//	call->insertArgument("CompletionType", TYP_SQLSMALLINT, (void*)CompletionType);
-//
-//	call->function_name = "SQLEndTran";
-//	call->function_id = SQL_API_SQLENDTRAN;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLTransact(SQLHENV henv,SQLHDBC hdbc,SQLUSMALLINT fType)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("henv", TYP_SQLHENV, henv);
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("fType", TYP_SQLUSMALLINT, (void*)fType);
-//
-//	call->function_name = "SQLTransact";
-//	call->function_id = SQL_API_SQLTRANSACT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLDisconnect(SQLHDBC hdbc)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+
+	call->function_name = "SQLDisconnect";
+	call->function_id = SQL_API_SQLDISCONNECT;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLEndTran(SQLSMALLINT HandleType,SQLHANDLE   Handle,SQLSMALLINT CompletionType)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)(intptr_t)HandleType);
+	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
+	call->insertArgument("CompletionType", TYP_SQLSMALLINT, (void*)(intptr_t)CompletionType);
+
+	call->function_name = "SQLEndTran";
+	call->function_id = SQL_API_SQLENDTRAN;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLTransact(SQLHENV henv,SQLHDBC hdbc,SQLUSMALLINT fType)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("henv", TYP_SQLHENV, henv);
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("fType", TYP_SQLUSMALLINT, (void*)(intptr_t)fType);
+
+	call->function_name = "SQLTransact";
+	call->function_id = SQL_API_SQLTRANSACT;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLNumResultCols(SQLHSTMT  hstmt, SQLSMALLINT FAR *pccol)
 //{
 //	ODBCTraceCall *call = new ODBCTraceCall();
@@ -1049,42 +1660,40 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLGetData(SQLHSTMT hstmt,SQLUSMALLINT icol,
-//								SQLSMALLINT fCType,
-//								SQLPOINTER rgbValue,
-//								SQLINTEGER cbValueMax, 
-//								SQLINTEGER FAR *pcbValue)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("icol", TYP_SQLUSMALLINT, (void*)icol);
-//	call->insertArgument("fCType", TYP_SQLSMALLINT, (void*)fCType);
-//	call->insertArgument("rgbValue", TYP_SQLPOINTER, rgbValue);
-//	call->insertArgument("cbValueMax", TYP_SQLINTEGER, (void*)cbValueMax);
-//	call->insertArgument("pcbValue", TYP_SQLINTEGER_PTR, pcbValue);
-//
-//	call->function_name = "SQLGetData";
-//	call->function_id = SQL_API_SQLGETDATA;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLRowCount(SQLHSTMT hstmt, SQLINTEGER FAR *pcrow)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("pcrow", TYP_SQLINTEGER_PTR, pcrow);
-//
-//	call->function_name = "SQLRowCount";
-//	call->function_id = SQL_API_SQLROWCOUNT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLGetData(SQLHSTMT hstmt,SQLUSMALLINT icol,
+								SQLSMALLINT fCType,
+								SQLPOINTER rgbValue,
+								SQLLEN cbValueMax, 
+								SQLLEN FAR *pcbValue)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("icol", TYP_SQLUSMALLINT, (void*)(intptr_t)icol);
+	call->insertArgument("fCType", TYP_SQLSMALLINT, (void*)(intptr_t)fCType);
+	call->insertArgument("rgbValue", TYP_SQLPOINTER, rgbValue);
+	call->insertArgument("cbValueMax", TYP_SQLINTEGER, (void*)(intptr_t)cbValueMax);
+	call->insertArgument("pcbValue", TYP_SQLINTEGER_PTR, pcbValue);
+
+	call->function_name = "SQLGetData";
+	call->function_id = SQL_API_SQLGETDATA;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLRowCount(SQLHSTMT hstmt, SQLLEN FAR *pcrow)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("pcrow", TYP_SQLINTEGER_PTR, pcrow);
+
+	call->function_name = "SQLRowCount";
+	call->function_id = SQL_API_SQLROWCOUNT;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLExtendedFetch(SQLHSTMT hstmt,
 //									  SQLUSMALLINT fFetchType,
 //									  SQLINTEGER irow,
@@ -1255,45 +1864,43 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLSetConnectAttr(SQLHDBC hdbc,
-//									   SQLINTEGER Attribute,
-//									   SQLPOINTER ValuePtr,
-//									   SQLINTEGER StringLength)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("Attribute", TYP_SQLINTEGER, (void*)Attribute);
-//	call->insertArgument("ValuePtr", TYP_SQLPOINTER, ValuePtr);
-//	call->insertArgument("StringLength", TYP_SQLINTEGER, (void*)StringLength);
-//
-//	call->function_name = "SQLSetConnectAttr";
-//	call->function_id = SQL_API_SQLSETCONNECTATTR;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLSetConnectAttrW(SQLHDBC hdbc,
-//									   SQLINTEGER Attribute,
-//									   SQLPOINTER ValuePtr,
-//									   SQLINTEGER StringLength)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("Attribute", TYP_SQLINTEGER, (void*)Attribute);
-//	call->insertArgument("ValuePtr", TYP_SQLPOINTER, ValuePtr);
-//	call->insertArgument("StringLength", TYP_SQLINTEGER, (void*)StringLength);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLSetConnectAttrW";
-//	call->function_id = SQL_API_SQLSETCONNECTATTR;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLSetConnectAttr(SQLHDBC hdbc,
+									   SQLINTEGER Attribute,
+									   SQLPOINTER ValuePtr,
+									   SQLINTEGER StringLength)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("Attribute", TYP_SQLINTEGER, (void*)(intptr_t)Attribute);
+	call->insertArgument("ValuePtr", TYP_SQLPOINTER, ValuePtr);
+	call->insertArgument("StringLength", TYP_SQLINTEGER, (void*)(intptr_t)StringLength);
+
+	call->function_name = "SQLSetConnectAttr";
+	call->function_id = SQL_API_SQLSETCONNECTATTR;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLSetConnectAttrW(SQLHDBC hdbc,
+									   SQLINTEGER Attribute,
+									   SQLPOINTER ValuePtr,
+									   SQLINTEGER StringLength)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("Attribute", TYP_SQLINTEGER, (void*)(intptr_t)Attribute);
+	call->insertArgument("ValuePtr", TYP_SQLPOINTER, ValuePtr);
+	call->insertArgument("StringLength", TYP_SQLINTEGER, (void*)(intptr_t)StringLength);
+
+	call->unicode = true;
+	call->function_name = "SQLSetConnectAttrW";
+	call->function_id = SQL_API_SQLSETCONNECTATTR;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLGetConnectAttr(SQLHDBC hdbc,
 //									   SQLINTEGER Attribute,
 //									   SQLPOINTER ValuePtr,
@@ -1509,35 +2116,34 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //RETCODE SQL_API TraceSQLSetScrollOptions(SQLHSTMT hstmt,
 //										 SQLUSMALLINT fConcurrency,
 //										 SQLINTEGER crowKeyset,
-//										 SQLUSMALLINT crowRowset)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("fConcurrency", TYP_SQLUSMALLINT, (void*)fConcurrency);
-//	call->insertArgument("crowKeyset", TYP_SQLINTEGER, (void*)crowKeyset);
-//	call->insertArgument("crowRowset", TYP_SQLUSMALLINT, (void*)crowRowset);
-//
-//	call->function_name = "SQLSetScrollOptions";
-//	call->function_id = SQL_API_SQLSETSCROLLOPTIONS;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLExecute(SQLHSTMT hstmt)
+//										 SQLUSMALLINT crowRowset)
 //{
 //	ODBCTraceCall *call = new ODBCTraceCall();
 //
 //	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+//	call->insertArgument("fConcurrency", TYP_SQLUSMALLINT, (void*)fConcurrency);
+//	call->insertArgument("crowKeyset", TYP_SQLINTEGER, (void*)crowKeyset);
+//	call->insertArgument("crowRowset", TYP_SQLUSMALLINT, (void*)crowRowset);
 //
-//	call->function_name = "SQLExecute";
-//	call->function_id = SQL_API_SQLEXECUTE;
+//	call->function_name = "SQLSetScrollOptions";
+//	call->function_id = SQL_API_SQLSETSCROLLOPTIONS;
 //
 //	ODBCTrace(call, true);
 //	return (RETCODE)stack.push(call);
 //
 //}
+RETCODE SQL_API TraceSQLExecute(SQLHSTMT hstmt)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+
+	call->function_name = "SQLExecute";
+	call->function_id = SQL_API_SQLEXECUTE;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLNativeSql(SQLHDBC hdbc,
 //								  SQLCHAR FAR *szSqlStrIn, 
 //								  SQLINTEGER cbSqlStrIn,
@@ -1614,19 +2220,18 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLCancel(SQLHSTMT hstmt)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//
-//	call->function_name = "SQLCancel";
-//	call->function_id = SQL_API_SQLCANCEL;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLCancel(SQLHSTMT hstmt)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+
+	call->function_name = "SQLCancel";
+	call->function_id = SQL_API_SQLCANCEL;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLAllocEnv(SQLHENV FAR * phenv)
 //{
 //	ODBCTraceCall *call = new ODBCTraceCall();
@@ -1767,51 +2372,48 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLAllocStmt(SQLHDBC hdbc,SQLHSTMT FAR *phstmt)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("phstmt", TYP_SQLHSTMT_PTR, phstmt);
-//
-//	call->function_name = "SQLAllocStmt";
-//	call->function_id = SQL_API_SQLALLOCSTMT;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLAllocHandle(SQLSMALLINT HandleType,
-//									SQLHANDLE   InputHandle,
-//									SQLHANDLE   *OutputHandlePtr)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)HandleType);
-//	call->insertArgument("InputHandle", TYP_SQLHANDLE, InputHandle);
-//	call->insertArgument("OutputHandlePtr", TYP_SQLHANDLE_PTR, OutputHandlePtr);
-//
-//	call->function_name = "SQLAllocHandle";
-//	call->function_id = SQL_API_SQLALLOCHANDLE;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLFreeHandle(SQLSMALLINT HandleType,SQLHANDLE   Handle)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)HandleType);
-//	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
-//
-//	call->function_name = "SQLFreeHandle";
-//	call->function_id = SQL_API_SQLFREEHANDLE;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLAllocStmt(SQLHDBC hdbc,SQLHSTMT FAR *phstmt)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("phstmt", TYP_SQLHSTMT_PTR, phstmt);
+
+	call->function_name = "SQLAllocStmt";
+	call->function_id = SQL_API_SQLALLOCSTMT;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLAllocHandle(SQLSMALLINT HandleType,
+									SQLHANDLE   InputHandle,
+									SQLHANDLE   *OutputHandlePtr)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)(intptr_t)HandleType);
+	call->insertArgument("InputHandle", TYP_SQLHANDLE, InputHandle);
+	call->insertArgument("OutputHandlePtr", TYP_SQLHANDLE_PTR, OutputHandlePtr);
+
+	call->function_name = "SQLAllocHandle";
+	call->function_id = SQL_API_SQLALLOCHANDLE;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLFreeHandle(SQLSMALLINT HandleType,SQLHANDLE   Handle)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)(intptr_t)HandleType);
+	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
+
+	call->function_name = "SQLFreeHandle";
+	call->function_id = SQL_API_SQLFREEHANDLE;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLSetCursorName(SQLHSTMT hstmt, SQLCHAR *szCursor, SQLSMALLINT cbCursor)
 //{
 //	ODBCTraceCall *call = new ODBCTraceCall();
@@ -1915,63 +2517,74 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLGetInfo(SQLHDBC hdbc, 
-//								SQLUSMALLINT fInfoType,  
-//								SQLPOINTER rgbInfoValue,
-//								SQLSMALLINT cbInfoValueMax,
-//								SQLSMALLINT FAR *pcbInfoValue)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("fInfoType", TYP_SQLUSMALLINT, (void*)fInfoType);
-//	call->insertArgument("rgbInfoValue", TYP_SQLPOINTER, rgbInfoValue);
-//	call->insertArgument("cbInfoValueMax", TYP_SQLSMALLINT, (void*)cbInfoValueMax);
-//	call->insertArgument("pcbInfoValue", TYP_SQLSMALLINT_PTR, pcbInfoValue);
-//
-//	call->function_name = "SQLGetInfo";
-//	call->function_id = SQL_API_SQLGETINFO;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLGetInfoW(SQLHDBC hdbc, 
-//								SQLUSMALLINT fInfoType,  
-//								SQLPOINTER rgbInfoValue,
-//								SQLSMALLINT cbInfoValueMax,
-//								SQLSMALLINT FAR *pcbInfoValue)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("fInfoType", TYP_SQLUSMALLINT, (void*)fInfoType);
-//	call->insertArgument("rgbInfoValue", TYP_SQLPOINTER, rgbInfoValue);
-//	call->insertArgument("cbInfoValueMax", TYP_SQLSMALLINT, (void*)cbInfoValueMax);
-//	call->insertArgument("pcbInfoValue", TYP_SQLSMALLINT_PTR, pcbInfoValue);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLGetInfoW";
-//	call->function_id = SQL_API_SQLGETINFO;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//RETCODE SQL_API TraceSQLGetTypeInfo(SQLHSTMT hstmt, SQLSMALLINT fSqlType)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("fSqlType", TYP_SQLSMALLINT, (void*)fSqlType);
-//
-//	call->function_name = "SQLGetTypeInfo";
-//	call->function_id = SQL_API_SQLGETTYPEINFO;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
+RETCODE SQL_API TraceSQLGetInfo(SQLHDBC hdbc, 
+								SQLUSMALLINT fInfoType,  
+								SQLPOINTER rgbInfoValue,
+								SQLSMALLINT cbInfoValueMax,
+								SQLSMALLINT FAR *pcbInfoValue)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("fInfoType", TYP_SQLUSMALLINT, (void*)(intptr_t)fInfoType);
+	call->insertArgument("rgbInfoValue", TYP_SQLPOINTER, rgbInfoValue);
+	call->insertArgument("cbInfoValueMax", TYP_SQLSMALLINT, (void*)(intptr_t)cbInfoValueMax);
+	call->insertArgument("pcbInfoValue", TYP_SQLSMALLINT_PTR, pcbInfoValue);
+
+	call->function_name = "SQLGetInfo";
+	call->function_id = SQL_API_SQLGETINFO;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLGetInfoW(SQLHDBC hdbc, 
+								SQLUSMALLINT fInfoType,  
+								SQLPOINTER rgbInfoValue,
+								SQLSMALLINT cbInfoValueMax,
+								SQLSMALLINT FAR *pcbInfoValue)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("fInfoType", TYP_SQLUSMALLINT, (void*)(intptr_t)fInfoType);
+	call->insertArgument("rgbInfoValue", TYP_SQLPOINTER, rgbInfoValue);
+	call->insertArgument("cbInfoValueMax", TYP_SQLSMALLINT, (void*)(intptr_t)cbInfoValueMax);
+	call->insertArgument("pcbInfoValue", TYP_SQLSMALLINT_PTR, pcbInfoValue);
+
+	call->unicode = true;
+	call->function_name = "SQLGetInfoW";
+	call->function_id = SQL_API_SQLGETINFO;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLGetTypeInfo(SQLHSTMT hstmt, SQLSMALLINT fSqlType)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("fSqlType", TYP_SQLSMALLINT, (void*)(intptr_t)fSqlType);
+
+	call->function_name = "SQLGetTypeInfo";
+	call->function_id = SQL_API_SQLGETTYPEINFO;
+
+	return (RETCODE)stack.push(call);
+
+}
+RETCODE SQL_API TraceSQLGetTypeInfoW(SQLHSTMT hstmt, SQLSMALLINT fSqlType)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("fSqlType", TYP_SQLSMALLINT, (void*)(intptr_t)fSqlType);
+
+	call->unicode = true;
+	call->function_name = "SQLGetTypeInfoW";
+	call->function_id = SQL_API_SQLGETTYPEINFO;
+
+	return (RETCODE)stack.push(call);
+
+}
 //RETCODE SQL_API TraceSQLGetFunctions(SQLHDBC hdbc,SQLUSMALLINT fFunction, SQLUSMALLINT FAR *pfExists)
 //{
 //	ODBCTraceCall *call = new ODBCTraceCall();
@@ -2038,123 +2651,119 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
-//RETCODE SQL_API TraceSQLGetDiagRec(SQLSMALLINT HandleType,
-//								   SQLHANDLE   Handle,
-//								   SQLSMALLINT RecNumber,
-//								   SQLCHAR     *Sqlstate,
-//								   SQLINTEGER  *NativeErrorPtr,
-//								   SQLCHAR     *MessageText,
-//								   SQLSMALLINT BufferLength,
-//								   SQLSMALLINT *TextLengthPtr)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)HandleType);
-//	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
-//	call->insertArgument("RecNumber", TYP_SQLSMALLINT, (void*)RecNumber);
-//	call->insertArgument("Sqlstate", TYP_SQLCHAR_PTR, Sqlstate);
-//	call->insertArgument("NativeErrorPtr", TYP_SQLINTEGER_PTR, NativeErrorPtr);
-//	call->insertArgument("MessageText", TYP_SQLCHAR_PTR, MessageText);
-//	call->insertArgument("BufferLength", TYP_SQLSMALLINT, (void*)BufferLength);
-//	call->insertArgument("TextLengthPtr", TYP_SQLSMALLINT_PTR, TextLengthPtr);
-//
-//	call->function_name = "SQLGetDiagRec";
-//	call->function_id = SQL_API_SQLGETDIAGREC;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//
-//RETCODE SQL_API TraceSQLGetDiagRecW(SQLSMALLINT HandleType,
-//								   SQLHANDLE   Handle,
-//								   SQLSMALLINT RecNumber,
-//								   SQLWCHAR     *Sqlstate,
-//								   SQLINTEGER  *NativeErrorPtr,
-//								   SQLWCHAR     *MessageText,
-//								   SQLSMALLINT BufferLength,
-//								   SQLSMALLINT *TextLengthPtr)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)HandleType);
-//	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
-//	call->insertArgument("RecNumber", TYP_SQLSMALLINT, (void*)RecNumber);
-//	call->insertArgument("Sqlstate", TYP_SQLWCHAR_PTR, Sqlstate);
-//	call->insertArgument("NativeErrorPtr", TYP_SQLINTEGER_PTR, NativeErrorPtr);
-//	call->insertArgument("MessageText", TYP_SQLWCHAR_PTR, MessageText);
-//	call->insertArgument("BufferLength", TYP_SQLSMALLINT, (void*)BufferLength);
-//	call->insertArgument("TextLengthPtr", TYP_SQLSMALLINT_PTR, TextLengthPtr);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLGetDiagRecW";
-//	call->function_id = SQL_API_SQLGETDIAGREC;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//
-//
-//RETCODE SQL_API TraceSQLError(SQLHENV henv, 
-//							  SQLHDBC hdbc, 
-//							  SQLHSTMT hstmt,
-//							  SQLCHAR FAR	  *szSqlState,
-//							  SQLINTEGER FAR *pfNativeError,
-//							  SQLCHAR FAR	  *szErrorMsg,
-//							  SQLSMALLINT	  cbErrorMsgMax,
-//							  SQLSMALLINT FAR *pcbErrorMsg)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("henv", TYP_SQLHENV, henv);
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("szSqlState", TYP_SQLCHAR_PTR, szSqlState);
-//	call->insertArgument("pfNativeError", TYP_SQLINTEGER_PTR, pfNativeError);
-//	call->insertArgument("szErrorMsg", TYP_SQLCHAR_PTR, szErrorMsg);
-//	call->insertArgument("cbErrorMsgMax", TYP_SQLSMALLINT, (void*)cbErrorMsgMax);
-//	call->insertArgument("pcbErrorMsg", TYP_SQLSMALLINT_PTR, pcbErrorMsg);
-//
-//
-//	call->function_name = "SQLError";
-//	call->function_id = SQL_API_SQLERROR;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//
-//RETCODE SQL_API TraceSQLErrorW(SQLHENV henv, 
-//							  SQLHDBC hdbc, 
-//							  SQLHSTMT hstmt,
-//							  SQLWCHAR FAR	  *szSqlState,
-//							  SQLINTEGER FAR *pfNativeError,
-//							  SQLWCHAR FAR	  *szErrorMsg,
-//							  SQLSMALLINT	  cbErrorMsgMax,
-//							  SQLSMALLINT FAR *pcbErrorMsg)
-//{
-//	ODBCTraceCall *call = new ODBCTraceCall();
-//
-//	call->insertArgument("henv", TYP_SQLHENV, henv);
-//	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
-//	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
-//	call->insertArgument("szSqlState", TYP_SQLWCHAR_PTR, szSqlState);
-//	call->insertArgument("pfNativeError", TYP_SQLINTEGER_PTR, pfNativeError);
-//	call->insertArgument("szErrorMsg", TYP_SQLWCHAR_PTR, szErrorMsg);
-//	call->insertArgument("cbErrorMsgMax", TYP_SQLSMALLINT, (void*)cbErrorMsgMax);
-//	call->insertArgument("pcbErrorMsg", TYP_SQLSMALLINT_PTR, pcbErrorMsg);
-//
-//	call->unicode = true;
-//	call->function_name = "SQLErrorW";
-//	call->function_id = SQL_API_SQLERROR;
-//
-//	ODBCTrace(call, true);
-//	return (RETCODE)stack.push(call);
-//
-//}
-//
-//
+RETCODE SQL_API TraceSQLGetDiagRec(SQLSMALLINT HandleType,
+								   SQLHANDLE   Handle,
+								   SQLSMALLINT RecNumber,
+								   SQLCHAR     *Sqlstate,
+								   SQLINTEGER  *NativeErrorPtr,
+								   SQLCHAR     *MessageText,
+								   SQLSMALLINT BufferLength,
+								   SQLSMALLINT *TextLengthPtr)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)(intptr_t)HandleType);
+	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
+	call->insertArgument("RecNumber", TYP_SQLSMALLINT, (void*)(intptr_t)RecNumber);
+	call->insertArgument("Sqlstate", TYP_SQLCHAR_PTR, Sqlstate);
+	call->insertArgument("NativeErrorPtr", TYP_SQLINTEGER_PTR, NativeErrorPtr);
+	call->insertArgument("MessageText", TYP_SQLCHAR_PTR, MessageText);
+	call->insertArgument("BufferLength", TYP_SQLSMALLINT, (void*)(intptr_t)BufferLength);
+	call->insertArgument("TextLengthPtr", TYP_SQLSMALLINT_PTR, TextLengthPtr);
+
+	call->function_name = "SQLGetDiagRec";
+	call->function_id = SQL_API_SQLGETDIAGREC;
+
+	return (RETCODE)stack.push(call);
+
+}
+
+RETCODE SQL_API TraceSQLGetDiagRecW(SQLSMALLINT HandleType,
+								   SQLHANDLE   Handle,
+								   SQLSMALLINT RecNumber,
+								   SQLWCHAR     *Sqlstate,
+								   SQLINTEGER  *NativeErrorPtr,
+								   SQLWCHAR     *MessageText,
+								   SQLSMALLINT BufferLength,
+								   SQLSMALLINT *TextLengthPtr)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("HandleType", TYP_SQLSMALLINT, (void*)(intptr_t)HandleType);
+	call->insertArgument("Handle", TYP_SQLHANDLE, Handle);
+	call->insertArgument("RecNumber", TYP_SQLSMALLINT, (void*)(intptr_t)RecNumber);
+	call->insertArgument("Sqlstate", TYP_SQLWCHAR_PTR, Sqlstate);
+	call->insertArgument("NativeErrorPtr", TYP_SQLINTEGER_PTR, NativeErrorPtr);
+	call->insertArgument("MessageText", TYP_SQLWCHAR_PTR, MessageText);
+	call->insertArgument("BufferLength", TYP_SQLSMALLINT, (void*)(intptr_t)BufferLength);
+	call->insertArgument("TextLengthPtr", TYP_SQLSMALLINT_PTR, TextLengthPtr);
+
+	call->unicode = true;
+	call->function_name = "SQLGetDiagRecW";
+	call->function_id = SQL_API_SQLGETDIAGREC;
+
+	return (RETCODE)stack.push(call);
+
+}
+
+
+RETCODE SQL_API TraceSQLError(SQLHENV henv, 
+							  SQLHDBC hdbc, 
+							  SQLHSTMT hstmt,
+							  SQLCHAR FAR	  *szSqlState,
+							  SQLINTEGER FAR *pfNativeError,
+							  SQLCHAR FAR	  *szErrorMsg,
+							  SQLSMALLINT	  cbErrorMsgMax,
+							  SQLSMALLINT FAR *pcbErrorMsg)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("henv", TYP_SQLHENV, henv);
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("szSqlState", TYP_SQLCHAR_PTR, szSqlState);
+	call->insertArgument("pfNativeError", TYP_SQLINTEGER_PTR, pfNativeError);
+	call->insertArgument("szErrorMsg", TYP_SQLCHAR_PTR, szErrorMsg);
+	call->insertArgument("cbErrorMsgMax", TYP_SQLSMALLINT, (void*)(intptr_t)cbErrorMsgMax);
+	call->insertArgument("pcbErrorMsg", TYP_SQLSMALLINT_PTR, pcbErrorMsg);
+
+
+	call->function_name = "SQLError";
+	call->function_id = SQL_API_SQLERROR;
+
+	return (RETCODE)stack.push(call);
+
+}
+
+RETCODE SQL_API TraceSQLErrorW(SQLHENV henv, 
+							  SQLHDBC hdbc, 
+							  SQLHSTMT hstmt,
+							  SQLWCHAR FAR	  *szSqlState,
+							  SQLINTEGER FAR *pfNativeError,
+							  SQLWCHAR FAR	  *szErrorMsg,
+							  SQLSMALLINT	  cbErrorMsgMax,
+							  SQLSMALLINT FAR *pcbErrorMsg)
+{
+	ODBCTraceCall *call = new ODBCTraceCall();
+
+	call->insertArgument("henv", TYP_SQLHENV, henv);
+	call->insertArgument("hdbc", TYP_SQLHDBC, hdbc);
+	call->insertArgument("hstmt", TYP_SQLHSTMT, hstmt);
+	call->insertArgument("szSqlState", TYP_SQLWCHAR_PTR, szSqlState);
+	call->insertArgument("pfNativeError", TYP_SQLINTEGER_PTR, pfNativeError);
+	call->insertArgument("szErrorMsg", TYP_SQLWCHAR_PTR, szErrorMsg);
+	call->insertArgument("cbErrorMsgMax", TYP_SQLSMALLINT, (void*)(intptr_t)cbErrorMsgMax);
+	call->insertArgument("pcbErrorMsg", TYP_SQLSMALLINT_PTR, pcbErrorMsg);
+
+	call->unicode = true;
+	call->function_name = "SQLErrorW";
+	call->function_id = SQL_API_SQLERROR;
+
+	return (RETCODE)stack.push(call);
+
+}
+
+
 //RETCODE SQL_API TraceSQLCopyDesc(SQLHDESC SourceDescHandle,SQLHDESC TargetDescHandle)
 //{
 //	ODBCTraceCall *call = new ODBCTraceCall();
@@ -2169,4 +2778,5 @@ RETCODE SQL_API TraceSQLCloseCursor(SQLHSTMT Handle)
 //	return (RETCODE)stack.push(call);
 //
 //}
- 
\ No newline at end of file
+ 
+}
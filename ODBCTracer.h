@@ -3,28 +3,8 @@
 
 #include <sstream>
 #include <sqltypes.h>
-
-class Mutex
-{
-public:
-	Mutex();
-	~Mutex();
-	void enter();
-	void leave();
-private:
-	CRITICAL_SECTION CriticalSection;
-};
-class MutexGuard
-{
-public:
-	MutexGuard(Mutex *mutex);
-	~MutexGuard();
-protected:
-	MutexGuard();
-	MutexGuard(const MutexGuard &);
-	MutexGuard & operator = (const MutexGuard &);
-	Mutex *mutex;
-};
+#include "ODBCPlatform.h"
+#include "ODBCSerializer.h"
 
 class ODBCTraceOptions
 {
@@ -33,16 +13,21 @@ private:
 	
 public:
 	static ODBCTraceOptions* get();	
-	bool recordLogging;
+	// The settings that can change while the log is open are in ODBCConfig
+	bool collector;
 	std::string logfile;
-	std::string statement;
-	std::clock_t begin_time;
-	int record_count;
 	int total_count;
 	int total_output;
 };
 
 #define ODBCTRACE_STACKSIZE 256
+// Defaults of the ODBCConfig progress settings: a statement still fetching
+// writes a progress line every this many records, or seconds.
+#define ODBCTRACE_PROGRESSROWS 1000000
+#define ODBCTRACE_PROGRESSINTERVAL 60
+// Default of the ODBCConfig breakdown setting: statements taking at least
+// this many milliseconds are broken down into driver and application time.
+#define ODBCTRACE_BREAKDOWNMIN 1000
 #define MAX_ARGUMENTS 20
 
 enum ODBCTracer_ArgumentTypes
@@ -85,12 +70,40 @@ struct ODBCTraceArgument
 	void *value;
 };
 
+// ODBCTraceNanoseconds for the calls ODBCOverhead samples, 0 for the others.
+long long ODBCOverheadSample();
+
 struct ODBCTraceCall
 {
 	void insertArgument(const char *name, ODBCTracer_ArgumentTypes type, void *value); 
 	int function_id;
+	const char *function_name;
+	bool unicode;
 	int arguments_count;
 	int retcode;
+	// Nanoseconds when the Trace* wrapper built the call and when it handed
+	// it on to the driver, 0 unless ODBCOverhead times this call
+	long long hook_time = ODBCOverheadSample();
+	long long driver_time;
+	// Thread and time of entering the Trace* wrapper, and of TraceReturn
+	unsigned long thread_id;
+	long long begin_time;
+	long long end_time;
+	// Set by the stack for the concurrency analysis: the driver of the
+	// handle, the order calls entered in, whether a call of another thread
+	// on the same driver ran at the same time, whether one was running
+	// already when this call entered and whether this call returned before
+	// such a call did.
+	std::string driver;
+	unsigned long long sequence;
+	bool overlapped;
+	bool entered_busy;
+	bool overtook;
+	// Set by the stack when an SQLCancel of another thread on the same
+	// statement entered while the call ran, the entry time of the SQLCancel,
+	// 0 for none; for the SQLCancel the calls it found running.
+	long long cancel_time;
+	int cancel_targets;
 	ODBCTraceArgument arguments[MAX_ARGUMENTS];
 };
 
@@ -101,10 +114,29 @@ struct ODBCTraceStack
 	ODBCTraceCall* pop(int index);
 	Mutex lock;
 	ODBCTraceCall* stack[ODBCTRACE_STACKSIZE];
+	int in_flight;
+	unsigned long long sequence;
+private:
+	int place(ODBCTraceCall *call, bool concurrency);
 };
 
 
 void ODBCTrace(ODBCTraceCall *call);
+// Writes the line of a call an SQLCancel interrupted, once it returned.
+void ODBCTraceCancelled(ODBCTraceCall *call);
+void ODBCWriteLog(std::string log);
+// A line as ODBCWriteLog writes it: "<log time> <process> <log>" or a record.
+std::string ODBCFormatLine(const std::string &log);
+// Writes a line that is formatted already.
+void ODBCWriteLine(const std::string &line);
+const std::string& ODBCProcessName();
+std::string ODBCProcessLogFile(const std::string &logfile);
+// Another file of this process next to the log: "<log file>.<pid><suffix>"
+// without the extension of the log file.
+std::string ODBCProcessFile(const std::string &logfile, const std::string &suffix);
+
+std::string ODBCFormatNumber(long long number);
+std::string ODBCArgumentString(const ODBCTraceArgument *text, const ODBCTraceArgument *length);
 
 
 #endif //#if !defined(ODBCDRIVERDELEGATOR_13_06_2005_ARINIR_H)
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "StdAfx.h"
+
+#if !defined(_WIN32)
+
+#include "ODBCUringFile.h"
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(ODBCTRACER_URING)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+ODBCUringFile::ODBCUringFile() : syscalls(0), fd(-1), ring(-1), registered(false), sq_map(MAP_FAILED), sq_map_size(0),
+	cq_map(MAP_FAILED), cq_map_size(0), sqes(NULL), sqes_size(0), next(0), failed(false)
+{
+	for (int i = 0; i < ODBCURING_BUFFERS; i++)
+	{
+		buffers[i] = NULL;
+		lengths[i] = 0;
+		busy[i] = false;
+	}
+}
+
+ODBCUringFile::~ODBCUringFile()
+{
+	close();
+}
+
+bool ODBCUringFile::open(const std::string &path)
+{
+	close();
+	// O_APPEND keeps the file shared with other processes, every write lands at its end
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	syscalls++;
+	if (fd < 0)
+		return false;
+	if (!setup())
+		teardown();
+	return true;
+}
+
+bool ODBCUringFile::opened() const
+{
+	return fd >= 0;
+}
+
+bool ODBCUringFile::uring() const
+{
+	return ring >= 0;
+}
+
+void ODBCUringFile::write(const char *data, size_t size)
+{
+	if (failed)
+	{
+		// An io_uring write failed, give up on io_uring once all writes are back
+		for (int i = 0; i < ODBCURING_BUFFERS; i++)
+			reap(i);
+		teardown();
+		failed = false;
+	}
+	if (ring < 0 || size > ODBCURING_BUFFERSIZE)
+	{
+		// Earlier writes must reach the file first
+		for (int i = 0; i < ODBCURING_BUFFERS; i++)
+			reap(i);
+		writeDirect(data, size);
+		return;
+	}
+
+	int slot = next;
+	next = (next + 1) % ODBCURING_BUFFERS;
+	reap(slot);
+	memcpy(buffers[slot], data, size);
+	submit(slot, size);
+}
+
+void ODBCUringFile::sync()
+{
+	if (fd < 0)
+		return;
+	for (int i = 0; i < ODBCURING_BUFFERS; i++)
+		reap(i);
+	fsync(fd);
+	syscalls++;
+}
+
+void ODBCUringFile::close()
+{
+	if (fd < 0)
+		return;
+	for (int i = 0; i < ODBCURING_BUFFERS; i++)
+		reap(i);
+	teardown();
+	::close(fd);
+	fd = -1;
+}
+
+void ODBCUringFile::writeDirect(const char *data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t written = ::write(fd, data, size);
+		syscalls++;
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return;
+		data += written;
+		size -= written;
+	}
+}
+
+#if defined(ODBCTRACER_URING)
+
+bool ODBCUringFile::setup()
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring = (int)syscall(__NR_io_uring_setup, ODBCURING_BUFFERS * 2, &params);
+	syscalls++;
+	if (ring < 0)
+		return false;
+
+	sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sq_map_size = cq_map_size = std::max(sq_map_size, cq_map_size);
+	sq_map = mmap(NULL, sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+	if (sq_map == MAP_FAILED)
+		return false;
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		cq_map = sq_map;
+	else
+	{
+		cq_map = mmap(NULL, cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+		if (cq_map == MAP_FAILED)
+			return false;
+	}
+	sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	void *mapped = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+	if (mapped == MAP_FAILED)
+		return false;
+	sqes = (struct io_uring_sqe*)mapped;
+
+	char *sq = (char*)sq_map;
+	char *cq = (char*)cq_map;
+	sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	sq_array = (unsigned*)(sq + params.sq_off.array);
+	cq_head = (unsigned*)(cq + params.cq_off.head);
+	cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	struct iovec vectors[ODBCURING_BUFFERS];
+	for (int i = 0; i < ODBCURING_BUFFERS; i++)
+	{
+		mapped = mmap(NULL, ODBCURING_BUFFERSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED)
+			return false;
+		buffers[i] = (char*)mapped;
+		vectors[i].iov_base = buffers[i];
+		vectors[i].iov_len = ODBCURING_BUFFERSIZE;
+	}
+
+	// Registering pins the buffers once instead of on every write, it fails
+	// beyond RLIMIT_MEMLOCK on older kernels and plain writes are used then
+	registered = syscall(__NR_io_uring_register, ring, IORING_REGISTER_BUFFERS, vectors, ODBCURING_BUFFERS) == 0;
+	syscalls++;
+	return true;
+}
+
+void ODBCUringFile::teardown()
+{
+	if (sqes)
+		munmap(sqes, sqes_size);
+	if (cq_map != MAP_FAILED && cq_map != sq_map)
+		munmap(cq_map, cq_map_size);
+	if (sq_map != MAP_FAILED)
+		munmap(sq_map, sq_map_size);
+	for (int i = 0; i < ODBCURING_BUFFERS; i++)
+	{
+		if (buffers[i])
+			munmap(buffers[i], ODBCURING_BUFFERSIZE);
+		buffers[i] = NULL;
+		busy[i] = false;
+	}
+	if (ring >= 0)
+		::close(ring);
+	ring = -1;
+	registered = false;
+	sqes = NULL;
+	sq_map = cq_map = MAP_FAILED;
+}
+
+void ODBCUringFile::submit(int slot, size_t size)
+{
+	unsigned tail = *sq_tail;
+	unsigned index = tail & *sq_mask;
+	struct io_uring_sqe *sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+	// Drained writes start after the earlier ones completed, so appends keep their order
+	sqe->flags = IOSQE_IO_DRAIN;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long long)(uintptr_t)buffers[slot];
+	sqe->len = (unsigned)size;
+	sqe->buf_index = (unsigned short)slot;
+	sqe->user_data = slot;
+	sq_array[index] = index;
+	__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	lengths[slot] = size;
+	busy[slot] = true;
+	for (;;)
+	{
+		syscalls++;
+		if (syscall(__NR_io_uring_enter, ring, 1, 0, 0, NULL, 0) >= 0)
+			return;
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			break;
+	}
+	// Not submitted, later calls never submit it either
+	busy[slot] = false;
+	failed = true;
+	writeDirect(buffers[slot], size);
+}
+
+// Collects the completions that arrived, waits until the slot is free.
+void ODBCUringFile::reap(int slot)
+{
+	while (ring >= 0)
+	{
+		unsigned head = *cq_head;
+		if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+		{
+			if (!busy[slot])
+				return;
+			syscalls++;
+			if (syscall(__NR_io_uring_enter, ring, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+			{
+				busy[slot] = false;
+				failed = true;
+				return;
+			}
+			continue;
+		}
+		struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+		int completed = (int)cqe->user_data;
+		int result = cqe->res;
+		__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+		complete(completed, result);
+	}
+}
+
+void ODBCUringFile::complete(int slot, int result)
+{
+	busy[slot] = false;
+	if (result == (int)lengths[slot])
+		return;
+
+	// Short or failed, write the rest directly
+	size_t written = result > 0 ? result : 0;
+	writeDirect(buffers[slot] + written, lengths[slot] - written);
+	failed = true;
+}
+
+#else
+
+bool ODBCUringFile::setup()
+{
+	return false;
+}
+
+void ODBCUringFile::teardown()
+{
+	ring = -1;
+}
+
+void ODBCUringFile::submit(int, size_t)
+{
+}
+
+void ODBCUringFile::reap(int)
+{
+}
+
+void ODBCUringFile::complete(int, int)
+{
+}
+
+#endif //#if defined(ODBCTRACER_URING)
+
+#endif //#if !defined(_WIN32)
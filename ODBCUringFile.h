@@ -0,0 +1,70 @@
+#if !defined(ODBCURINGFILE_H)
+#define ODBCURINGFILE_H
+
+#if !defined(_WIN32)
+
+#include <string>
+
+// Registered buffers, a write waits only while all of them are in flight.
+#define ODBCURING_BUFFERS 2
+// Bytes of one registered buffer, larger writes are written synchronously.
+#define ODBCURING_BUFFERSIZE (2 * 1024 * 1024)
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Appends to a file through io_uring on Linux: a write copies the data into
+// a free registered buffer, submits it and returns without waiting for the
+// disk. Writes are drained in order, so the file stays an append only log
+// shared with other processes. Without io_uring (another system, an old
+// kernel or a sandbox that forbids it) or after an io_uring write failed,
+// every write is a plain write(2).
+class ODBCUringFile
+{
+public:
+	ODBCUringFile();
+	~ODBCUringFile();
+	bool open(const std::string &path);
+	void write(const char *data, size_t size);
+	// Waits for the writes in flight and syncs the file to disk.
+	void sync();
+	void close();
+	bool opened() const;
+	bool uring() const;
+	unsigned long long syscalls;
+
+private:
+	bool setup();
+	void teardown();
+	void submit(int slot, size_t size);
+	void reap(int slot);
+	void complete(int slot, int result);
+	void writeDirect(const char *data, size_t size);
+
+	int fd;
+	int ring;
+	bool registered;
+	void *sq_map;
+	size_t sq_map_size;
+	void *cq_map;
+	size_t cq_map_size;
+	io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	io_uring_cqe *cqes;
+
+	char *buffers[ODBCURING_BUFFERS];
+	size_t lengths[ODBCURING_BUFFERS];
+	bool busy[ODBCURING_BUFFERS];
+	int next;
+	bool failed;
+};
+
+#endif //#if !defined(_WIN32)
+
+#endif //#if !defined(ODBCURINGFILE_H)
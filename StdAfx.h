@@ -1,5 +1,7 @@
 
+#if defined(_MSC_VER)
 #pragma warning(disable:4786)
+#endif
 
 #if !defined(AFX_STDAFX_H__4D1AD7FD_E564_46A9_8D2E_153923741E63__INCLUDED_)
 #define AFX_STDAFX_H__4D1AD7FD_E564_46A9_8D2E_153923741E63__INCLUDED_
@@ -10,6 +12,7 @@
 
 
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN	
 
 #include <windows.h>
@@ -20,10 +23,18 @@
 #include <malloc.h>
 #include <memory.h>
 #include <tchar.h>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#endif
 
 #include <map>
+#include <list>
 #include <vector>
 #include <string>
 #include <regex>
+#include <algorithm>
 
 #endif 
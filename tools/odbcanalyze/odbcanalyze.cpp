@@ -0,0 +1,461 @@
+// odbcanalyze - parallel analyzer for ODBCTracer log files.
+//
+// Memory-maps every file, splits the files on line boundaries into chunks
+// that all cores parse concurrently, fingerprints each statement with the
+// tracer's own ODBCFingerprintNormalize and aggregates per thread. Lines are
+// parsed in place; the only allocations are for fingerprints seen for the
+// first time by a thread. Per-thread aggregates are merged at the end into
+// top-N reports by total time, count, rows and p99 latency.
+//
+// Parses the statement lines written by ODBCWriteLog:
+//   time proc pid Nms [N Recs] [(N Total)] sql
+// Other lines (catalog, loop summaries) are counted and skipped.
+//
+// Usage: odbcanalyze [-t threads] [-n top] file...
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../../ODBCFingerprint.h"
+
+// Bytes of a file parsed as one unit of work.
+#define CHUNK_SIZE (64 * 1024 * 1024)
+// Log-linear latency histogram: exact below 64ms, then 16 buckets per power
+// of two, which bounds the error of a percentile to about 6%.
+#define HISTOGRAM_LINEAR 64
+#define HISTOGRAM_SUBBUCKETS 16
+#define HISTOGRAM_BUCKETS (HISTOGRAM_LINEAR + 58 * HISTOGRAM_SUBBUCKETS)
+
+struct MappedFile
+{
+	std::string path;
+	const char *data;
+	size_t size;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+struct Chunk
+{
+	const char *begin;
+	const char *end;
+};
+
+struct Aggregate
+{
+	unsigned long long count;
+	unsigned long long total_ms;
+	unsigned long long max_ms;
+	unsigned long long rows;
+	unsigned int histogram[HISTOGRAM_BUCKETS];
+	std::string text;
+};
+
+typedef std::unordered_map<unsigned long long, Aggregate> AggregateMap;
+
+struct Worker
+{
+	AggregateMap aggregates;
+	unsigned long long lines;
+	unsigned long long skipped;
+	std::vector<char> normalized;
+};
+
+static int histogramBucket(unsigned long long ms)
+{
+	if (ms < HISTOGRAM_LINEAR)
+		return (int)ms;
+	int power = 63;
+	while (!(ms >> power))
+		power--;
+	// power >= 6, the four bits below the leading one select the sub-bucket
+	int sub = (int)((ms >> (power - 4)) & (HISTOGRAM_SUBBUCKETS - 1));
+	int bucket = HISTOGRAM_LINEAR + (power - 6) * HISTOGRAM_SUBBUCKETS + sub;
+	return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+// Upper bound in milliseconds of the values in a bucket.
+static unsigned long long histogramLimit(int bucket)
+{
+	if (bucket < HISTOGRAM_LINEAR)
+		return bucket;
+	int power = (bucket - HISTOGRAM_LINEAR) / HISTOGRAM_SUBBUCKETS + 6;
+	int sub = (bucket - HISTOGRAM_LINEAR) % HISTOGRAM_SUBBUCKETS;
+	return ((unsigned long long)(HISTOGRAM_SUBBUCKETS + sub + 1) << (power - 4)) - 1;
+}
+
+static unsigned long long percentile(const Aggregate &aggregate, double fraction)
+{
+	unsigned long long target = (unsigned long long)ceil(aggregate.count * fraction);
+	unsigned long long seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += aggregate.histogram[i];
+		if (seen >= target)
+			return std::min(histogramLimit(i), aggregate.max_ms);
+	}
+	return aggregate.max_ms;
+}
+
+static bool mapFile(const char *path, MappedFile *mapped)
+{
+	mapped->path = path;
+	mapped->data = NULL;
+	mapped->size = 0;
+#if defined(_WIN32)
+	mapped->file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mapped->file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	GetFileSizeEx(mapped->file, &size);
+	mapped->size = (size_t)size.QuadPart;
+	mapped->mapping = NULL;
+	if (mapped->size == 0)
+		return true;
+	mapped->mapping = CreateFileMapping(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapped->mapping == NULL)
+		return false;
+	mapped->data = (const char*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+	return mapped->data != NULL;
+#else
+	mapped->fd = open(path, O_RDONLY);
+	if (mapped->fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(mapped->fd, &info) != 0)
+		return false;
+	mapped->size = (size_t)info.st_size;
+	if (mapped->size == 0)
+		return true;
+	void *data = mmap(NULL, mapped->size, PROT_READ, MAP_PRIVATE, mapped->fd, 0);
+	if (data == MAP_FAILED)
+		return false;
+	madvise(data, mapped->size, MADV_SEQUENTIAL);
+	mapped->data = (const char*)data;
+	return true;
+#endif
+}
+
+static void unmapFile(MappedFile *mapped)
+{
+#if defined(_WIN32)
+	if (mapped->data)
+		UnmapViewOfFile(mapped->data);
+	if (mapped->mapping)
+		CloseHandle(mapped->mapping);
+	CloseHandle(mapped->file);
+#else
+	if (mapped->data)
+		munmap((void*)mapped->data, mapped->size);
+	close(mapped->fd);
+#endif
+}
+
+// Splits a file into chunks of about CHUNK_SIZE that end after a newline.
+static void splitFile(const MappedFile &mapped, std::vector<Chunk> &chunks)
+{
+	const char *begin = mapped.data;
+	const char *end = mapped.data + mapped.size;
+	while (begin < end)
+	{
+		const char *split = end - begin > CHUNK_SIZE ? begin + CHUNK_SIZE : end;
+		if (split < end)
+		{
+			const char *newline = (const char*)memchr(split, '\n', end - split);
+			split = newline ? newline + 1 : end;
+		}
+		Chunk chunk = { begin, split };
+		chunks.push_back(chunk);
+		begin = split;
+	}
+}
+
+static const char* skipSpaces(const char *p, const char *end)
+{
+	while (p < end && *p == ' ')
+		p++;
+	return p;
+}
+
+static const char* tokenEnd(const char *p, const char *end)
+{
+	while (p < end && *p != ' ')
+		p++;
+	return p;
+}
+
+// Parses a number with thousands separators followed by suffix, e.g.
+// "1,234ms"; the token must end right after the suffix.
+static bool parseNumber(const char *p, const char *token_end, const char *suffix, unsigned long long *value)
+{
+	size_t suffix_length = strlen(suffix);
+	if ((size_t)(token_end - p) <= suffix_length || memcmp(token_end - suffix_length, suffix, suffix_length) != 0)
+		return false;
+	unsigned long long number = 0;
+	for (const char *c = p; c < token_end - suffix_length; c++)
+	{
+		if (*c >= '0' && *c <= '9')
+			number = number * 10 + (*c - '0');
+		else if (*c != ',')
+			return false;
+	}
+	*value = number;
+	return true;
+}
+
+static bool isNumber(const char *p, const char *token_end)
+{
+	if (p == token_end)
+		return false;
+	for (; p < token_end; p++)
+		if (*p < '0' || *p > '9')
+			return false;
+	return true;
+}
+
+static void parseLine(Worker *worker, const char *line, const char *end)
+{
+	if (end > line && end[-1] == '\r')
+		end--;
+
+	// The process name may contain spaces, so look for "pid Nms" after the time
+	const char *p = tokenEnd(line, end);
+	unsigned long long ms = 0;
+	const char *sql = NULL;
+	while (p < end)
+	{
+		const char *token = skipSpaces(p, end);
+		const char *token_end = tokenEnd(token, end);
+		if (isNumber(token, token_end))
+		{
+			const char *next = skipSpaces(token_end, end);
+			const char *next_end = tokenEnd(next, end);
+			if (parseNumber(next, next_end, "ms", &ms))
+			{
+				sql = skipSpaces(next_end, end);
+				break;
+			}
+		}
+		p = token_end;
+	}
+	if (sql == NULL || sql >= end)
+	{
+		worker->skipped++;
+		return;
+	}
+
+	unsigned long long rows = 0;
+	const char *token_end = tokenEnd(sql, end);
+	const char *next = skipSpaces(token_end, end);
+	const char *next_end = tokenEnd(next, end);
+	if (next_end - next == 4 && memcmp(next, "Recs", 4) == 0 && parseNumber(sql, token_end, "", &rows))
+	{
+		sql = skipSpaces(next_end, end);
+		if (sql < end && *sql == '(')
+		{
+			const char *close = (const char*)memchr(sql, ')', end - sql);
+			if (close && close - sql > 6 && memcmp(close - 5, "Total", 5) == 0)
+				sql = skipSpaces(close + 1, end);
+		}
+	}
+
+	size_t length = end - sql;
+	if (worker->normalized.size() < length)
+		worker->normalized.resize(length);
+	size_t normalized_length = ODBCFingerprintNormalize(sql, length, worker->normalized.data());
+	unsigned long long hash = ODBCFingerprintHash(worker->normalized.data(), normalized_length);
+
+	auto it = worker->aggregates.find(hash);
+	if (it == worker->aggregates.end())
+	{
+		Aggregate &created = worker->aggregates[hash];
+		memset(created.histogram, 0, sizeof(created.histogram));
+		created.count = created.total_ms = created.max_ms = created.rows = 0;
+		created.text.assign(worker->normalized.data(), normalized_length);
+		it = worker->aggregates.find(hash);
+	}
+	Aggregate &aggregate = it->second;
+	aggregate.count++;
+	aggregate.total_ms += ms;
+	aggregate.rows += rows;
+	if (ms > aggregate.max_ms)
+		aggregate.max_ms = ms;
+	aggregate.histogram[histogramBucket(ms)]++;
+	worker->lines++;
+}
+
+static void parseChunk(Worker *worker, const Chunk &chunk)
+{
+	const char *line = chunk.begin;
+	while (line < chunk.end)
+	{
+		const char *newline = (const char*)memchr(line, '\n', chunk.end - line);
+		const char *end = newline ? newline : chunk.end;
+		if (end > line)
+			parseLine(worker, line, end);
+		line = end + 1;
+	}
+}
+
+static void merge(AggregateMap &into, AggregateMap &from)
+{
+	for (auto it = from.begin(); it != from.end(); ++it)
+	{
+		auto found = into.find(it->first);
+		if (found == into.end())
+		{
+			into[it->first] = std::move(it->second);
+			continue;
+		}
+		Aggregate &aggregate = found->second;
+		aggregate.count += it->second.count;
+		aggregate.total_ms += it->second.total_ms;
+		aggregate.rows += it->second.rows;
+		aggregate.max_ms = std::max(aggregate.max_ms, it->second.max_ms);
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+			aggregate.histogram[i] += it->second.histogram[i];
+	}
+	from.clear();
+}
+
+struct Ranked
+{
+	const Aggregate *aggregate;
+	unsigned long long p99;
+};
+
+static void report(const char *title, std::vector<Ranked> &ranked, size_t top,
+	bool (*compare)(const Ranked &, const Ranked &))
+{
+	size_t count = std::min(top, ranked.size());
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), compare);
+
+	printf("\nTop %u by %s\n", (unsigned int)count, title);
+	printf("%14s %12s %10s %10s %14s  %s\n", "TOTAL ms", "COUNT", "AVG ms", "P99 ms", "ROWS", "FINGERPRINT");
+	for (size_t i = 0; i < count; i++)
+	{
+		const Aggregate *aggregate = ranked[i].aggregate;
+		printf("%14llu %12llu %10.1f %10llu %14llu  %.100s\n",
+			aggregate->total_ms, aggregate->count, (double)aggregate->total_ms / aggregate->count,
+			ranked[i].p99, aggregate->rows, aggregate->text.c_str());
+	}
+}
+
+static bool byTotalTime(const Ranked &a, const Ranked &b) { return a.aggregate->total_ms > b.aggregate->total_ms; }
+static bool byCount(const Ranked &a, const Ranked &b) { return a.aggregate->count > b.aggregate->count; }
+static bool byRows(const Ranked &a, const Ranked &b) { return a.aggregate->rows > b.aggregate->rows; }
+static bool byP99(const Ranked &a, const Ranked &b) { return a.p99 > b.p99; }
+
+static void usage()
+{
+	fprintf(stderr, "usage: odbcanalyze [-t threads] [-n top] file...\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int threads = std::thread::hardware_concurrency();
+	size_t top = 20;
+	std::vector<const char*> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threads = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			top = (size_t)atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+			usage();
+		else
+			paths.push_back(argv[i]);
+	}
+	if (paths.empty())
+		usage();
+	if (threads == 0)
+		threads = 1;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<MappedFile> files(paths.size());
+	std::vector<Chunk> chunks;
+	unsigned long long bytes = 0;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		if (!mapFile(paths[i], &files[i]))
+		{
+			fprintf(stderr, "odbcanalyze: cannot map %s\n", paths[i]);
+			return 1;
+		}
+		splitFile(files[i], chunks);
+		bytes += files[i].size;
+	}
+
+	std::vector<Worker> workers(threads);
+	std::atomic<size_t> next_chunk(0);
+	std::vector<std::thread> pool;
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		Worker *worker = &workers[t];
+		worker->lines = worker->skipped = 0;
+		pool.push_back(std::thread([worker, &chunks, &next_chunk]()
+		{
+			for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++)
+				parseChunk(worker, chunks[i]);
+		}));
+	}
+	for (size_t t = 0; t < pool.size(); t++)
+		pool[t].join();
+
+	AggregateMap merged;
+	unsigned long long lines = 0, skipped = 0;
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		merge(merged, workers[t].aggregates);
+		lines += workers[t].lines;
+		skipped += workers[t].skipped;
+	}
+
+	std::vector<Ranked> ranked;
+	ranked.reserve(merged.size());
+	for (auto it = merged.begin(); it != merged.end(); ++it)
+	{
+		Ranked entry = { &it->second, percentile(it->second, 0.99) };
+		ranked.push_back(entry);
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%u files, %.1f MB, %llu statements, %llu other lines, %u fingerprints, %u threads, %.2fs (%.1f MB/s)\n",
+		(unsigned int)files.size(), bytes / 1048576.0, lines, skipped, (unsigned int)merged.size(), threads,
+		seconds, seconds > 0 ? bytes / 1048576.0 / seconds : 0);
+
+	report("total time", ranked, top, byTotalTime);
+	report("count", ranked, top, byCount);
+	report("rows", ranked, top, byRows);
+	report("p99 latency", ranked, top, byP99);
+
+	for (size_t i = 0; i < files.size(); i++)
+		unmapFile(&files[i]);
+	return 0;
+}
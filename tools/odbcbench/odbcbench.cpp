@@ -0,0 +1,346 @@
+// odbcbench - measures the overhead of the ODBCTracer library.
+//
+// Loads the tracer like a driver manager does and drives its exported
+// Trace* / TraceReturn entry points from 1..N threads, each thread with its
+// own connection and statement handle. For every tracing mode (selected by
+// the log file name, as with the real driver manager) and workload it
+// reports ns/call per thread and calls/sec over all threads, so every
+// change to the tracer can be checked against a number. After each mode it
+// reports how the log was written: lines, syscalls per line and process CPU
+// per MB of log, which compares the stdio writer with the io_uring one.
+//
+// Workloads:
+//   fetch      TraceSQLFetch + TraceReturn
+//   statement  ExecDirect, 10 fetches, end of data and CloseCursor, which
+//              writes one statement line to the log
+//
+// The uring mode is the replay mode written through io_uring. -s appends
+// further options to every log file name, -s _flush1000 for example.
+//
+// Usage: odbcbench [-l library] [-o directory] [-t threads] [-d seconds]
+//                  [-m records|nc|replay|uring] [-w fetch|statement]
+//                  [-s suffix] [-k]
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <sys/resource.h>
+#endif
+#include <sql.h>
+#include <sqlext.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+
+typedef RETCODE (SQL_API *TraceOpenLogFileFunction)(SQLWCHAR*, SQLWCHAR*, DWORD);
+typedef RETCODE (SQL_API *TraceCloseLogFileFunction)();
+typedef void (SQL_API *TraceReturnFunction)(RETCODE, RETCODE);
+typedef RETCODE (SQL_API *TraceSQLAllocHandleFunction)(SQLSMALLINT, SQLHANDLE, SQLHANDLE*);
+typedef RETCODE (SQL_API *TraceSQLFreeHandleFunction)(SQLSMALLINT, SQLHANDLE);
+typedef RETCODE (SQL_API *TraceSQLFetchFunction)(SQLHSTMT);
+typedef RETCODE (SQL_API *TraceSQLExecDirectFunction)(SQLHSTMT, SQLCHAR*, SQLINTEGER);
+typedef RETCODE (SQL_API *TraceSQLCloseCursorFunction)(SQLHSTMT);
+
+struct Tracer
+{
+	TraceOpenLogFileFunction openLogFile;
+	TraceCloseLogFileFunction closeLogFile;
+	TraceReturnFunction traceReturn;
+	TraceSQLAllocHandleFunction allocHandle;
+	TraceSQLFreeHandleFunction freeHandle;
+	TraceSQLFetchFunction fetch;
+	TraceSQLExecDirectFunction execDirect;
+	TraceSQLCloseCursorFunction closeCursor;
+};
+
+enum Workload
+{
+	WORKLOAD_FETCH,
+	WORKLOAD_STATEMENT
+};
+
+// Calls per iteration of the statement workload
+#define STATEMENT_FETCHES 10
+#define STATEMENT_CALLS (STATEMENT_FETCHES + 3)
+
+static void* loadSymbol(void *library, const char *name)
+{
+#if defined(_WIN32)
+	void *symbol = (void*)GetProcAddress((HMODULE)library, name);
+#else
+	void *symbol = dlsym(library, name);
+#endif
+	if (symbol == NULL)
+	{
+		fprintf(stderr, "odbcbench: %s not exported\n", name);
+		exit(1);
+	}
+	return symbol;
+}
+
+static void loadTracer(const char *path, Tracer *tracer)
+{
+#if defined(_WIN32)
+	void *library = (void*)LoadLibrary(path);
+#else
+	void *library = dlopen(path, RTLD_NOW);
+#endif
+	if (library == NULL)
+	{
+		fprintf(stderr, "odbcbench: cannot load %s\n", path);
+		exit(1);
+	}
+	tracer->openLogFile = (TraceOpenLogFileFunction)loadSymbol(library, "TraceOpenLogFile");
+	tracer->closeLogFile = (TraceCloseLogFileFunction)loadSymbol(library, "TraceCloseLogFile");
+	tracer->traceReturn = (TraceReturnFunction)loadSymbol(library, "TraceReturn");
+	tracer->allocHandle = (TraceSQLAllocHandleFunction)loadSymbol(library, "TraceSQLAllocHandle");
+	tracer->freeHandle = (TraceSQLFreeHandleFunction)loadSymbol(library, "TraceSQLFreeHandle");
+	tracer->fetch = (TraceSQLFetchFunction)loadSymbol(library, "TraceSQLFetch");
+	tracer->execDirect = (TraceSQLExecDirectFunction)loadSymbol(library, "TraceSQLExecDirect");
+	tracer->closeCursor = (TraceSQLCloseCursorFunction)loadSymbol(library, "TraceSQLCloseCursor");
+}
+
+static unsigned long long benchThread(const Tracer *tracer, Workload workload, int id, const std::atomic<bool> *stop)
+{
+	// Handle values only have to be distinct, the tracer never dereferences them
+	SQLHANDLE hdbc = (SQLHANDLE)(intptr_t)(0x100000 + id * 0x100);
+	SQLHANDLE hstmt = (SQLHANDLE)(intptr_t)(0x100000 + id * 0x100 + 0x10);
+
+	SQLHANDLE allocated = NULL;
+	RETCODE call = tracer->allocHandle(SQL_HANDLE_STMT, hdbc, &allocated);
+	allocated = hstmt;
+	tracer->traceReturn(call, SQL_SUCCESS);
+
+	char sql[64];
+	unsigned long long calls = 0;
+	for (unsigned long long i = 0; !stop->load(std::memory_order_relaxed); i++)
+	{
+		if (workload == WORKLOAD_FETCH)
+		{
+			tracer->traceReturn(tracer->fetch(hstmt), SQL_SUCCESS);
+			calls++;
+			continue;
+		}
+
+		snprintf(sql, sizeof(sql), "SELECT * FROM orders WHERE id = %llu", i);
+		tracer->traceReturn(tracer->execDirect(hstmt, (SQLCHAR*)sql, SQL_NTS), SQL_SUCCESS);
+		for (int f = 0; f < STATEMENT_FETCHES; f++)
+			tracer->traceReturn(tracer->fetch(hstmt), SQL_SUCCESS);
+		tracer->traceReturn(tracer->fetch(hstmt), SQL_NO_DATA);
+		tracer->traceReturn(tracer->closeCursor(hstmt), SQL_SUCCESS);
+		calls += STATEMENT_CALLS;
+	}
+
+	tracer->traceReturn(tracer->freeHandle(SQL_HANDLE_STMT, hstmt), SQL_SUCCESS);
+	return calls;
+}
+
+static void bench(const Tracer *tracer, const char *mode, const char *workload_name, Workload workload,
+	int threads, double seconds)
+{
+	std::atomic<bool> stop(false);
+	std::vector<unsigned long long> calls(threads);
+	std::vector<std::thread> pool;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int t = 0; t < threads; t++)
+		pool.push_back(std::thread([tracer, workload, t, &stop, &calls]()
+		{
+			calls[t] = benchThread(tracer, workload, t, &stop);
+		}));
+	std::this_thread::sleep_for(std::chrono::microseconds((long long)(seconds * 1000000)));
+	stop.store(true);
+	for (int t = 0; t < threads; t++)
+		pool[t].join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned long long total = 0;
+	for (int t = 0; t < threads; t++)
+		total += calls[t];
+	printf("%-8s %-10s %7d %14llu %12.1f %14.0f\n", mode, workload_name, threads, total,
+		total ? elapsed * threads * 1e9 / total : 0, total / elapsed);
+	fflush(stdout);
+}
+
+static double processCpuSeconds()
+{
+#if defined(_WIN32)
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	unsigned long long ticks = ((unsigned long long)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+		((unsigned long long)user.dwHighDateTime << 32 | user.dwLowDateTime);
+	return ticks / 1e7;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+static long long fileSize(const std::string &path)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+		return 0;
+	fseek(file, 0, SEEK_END);
+	long long size = ftell(file);
+	fclose(file);
+	return size;
+}
+
+static unsigned long long parseNumber(const std::string &text)
+{
+	unsigned long long number = 0;
+	for (size_t i = 0; i < text.size(); i++)
+		if (text[i] >= '0' && text[i] <= '9')
+			number = number * 10 + (text[i] - '0');
+	return number;
+}
+
+// Reports the writer line the tracer appends when the log is closed:
+// "<pid> writer F Flushes L Lines ... S Syscalls <backend>", or a JSON or
+// CSV record of type writer with that text.
+static void reportWriter(const char *mode, const std::string &logfile, long long bytes, double cpu)
+{
+	std::string last;
+	char line[4096];
+	FILE *file = fopen(logfile.c_str(), "r");
+	if (file == NULL)
+		return;
+	long long size = fileSize(logfile);
+	fseek(file, size > (long long)sizeof(line) ? (long)(size - sizeof(line)) : 0, SEEK_SET);
+	while (fgets(line, sizeof(line), file))
+		if (strstr(line, "writer") != NULL && strstr(line, " Syscalls ") != NULL)
+			last = line;
+	fclose(file);
+
+	std::vector<std::string> words;
+	for (size_t begin = 0, end; begin < last.size(); begin = end + 1)
+	{
+		end = last.find_first_of(" \n", begin);
+		if (end == std::string::npos)
+			end = last.size();
+		if (end > begin)
+			words.push_back(last.substr(begin, end - begin));
+	}
+	unsigned long long lines = 0, syscalls = 0;
+	for (size_t i = 1; i < words.size(); i++)
+	{
+		if (words[i] == "Lines")
+			lines = parseNumber(words[i - 1]);
+		else if (words[i] == "Syscalls")
+			syscalls = parseNumber(words[i - 1]);
+	}
+	if (lines == 0 || bytes <= 0)
+		return;
+	std::string backend = words.back();
+	backend.erase(backend.find_last_not_of("\"}") + 1);
+
+	// CPU per MB covers the whole run, it is only telling for logs of some size
+	double megabytes = bytes / 1048576.0;
+	printf("%-8s writer %s: %llu lines, %.1f MB, %.3f syscalls/line", mode, backend.c_str(),
+		lines, megabytes, (double)syscalls / lines);
+	if (megabytes >= 1)
+		printf(", %.1f ms CPU/MB", cpu * 1000 / megabytes);
+	printf("\n");
+	fflush(stdout);
+}
+
+static void usage()
+{
+	fprintf(stderr, "usage: odbcbench [-l library] [-o directory] [-t threads] [-d seconds] [-m records|nc|replay|uring] [-w fetch|statement] [-s suffix] [-k]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+#if defined(_WIN32)
+	const char *library = "ODBCTracer.dll";
+	std::string directory = ".\\";
+#else
+	const char *library = "./libODBCTracer.so";
+	std::string directory = "./";
+#endif
+	int max_threads = (int)std::thread::hardware_concurrency();
+	double seconds = 1;
+	const char *only_mode = NULL;
+	const char *only_workload = NULL;
+	std::string suffix;
+	bool keep = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-k") == 0)
+			keep = true;
+		else if (i + 1 >= argc)
+			usage();
+		else if (strcmp(argv[i], "-l") == 0)
+			library = argv[++i];
+		else if (strcmp(argv[i], "-o") == 0)
+			directory = std::string(argv[++i]) + "/";
+		else if (strcmp(argv[i], "-t") == 0)
+			max_threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-d") == 0)
+			seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "-m") == 0)
+			only_mode = argv[++i];
+		else if (strcmp(argv[i], "-w") == 0)
+			only_workload = argv[++i];
+		else if (strcmp(argv[i], "-s") == 0)
+			suffix = argv[++i];
+		else
+			usage();
+	}
+	if (max_threads < 1)
+		max_threads = 1;
+	if (seconds <= 0)
+		usage();
+
+	Tracer tracer;
+	loadTracer(library, &tracer);
+
+	// The driver manager selects the tracing mode through the log file name
+	const char *modes[] = { "records", "nc", "replay", "uring" };
+	const char *logfiles[] = { "odbcbench", "odbcbench_nc", "odbcbench_replay", "odbcbench_replay_uring" };
+	const char *workloads[] = { "fetch", "statement" };
+
+	printf("%-8s %-10s %7s %14s %12s %14s\n", "MODE", "WORKLOAD", "THREADS", "CALLS", "NS/CALL", "CALLS/SEC");
+	for (int m = 0; m < 4; m++)
+	{
+		if (only_mode != NULL && strcmp(only_mode, modes[m]) != 0)
+			continue;
+
+		std::string logfile = directory + logfiles[m] + suffix + ".log";
+		long long size = fileSize(logfile);
+		double cpu = processCpuSeconds();
+		// SQLWCHAR is 16 bit under unixODBC, where wchar_t is 32 bit
+		std::vector<SQLWCHAR> path(logfile.begin(), logfile.end());
+		path.push_back(0);
+		tracer.openLogFile(path.data(), NULL, 0);
+
+		for (int w = 0; w < 2; w++)
+		{
+			if (only_workload != NULL && strcmp(only_workload, workloads[w]) != 0)
+				continue;
+			for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads)
+			{
+				bench(&tracer, modes[m], workloads[w], (Workload)w, threads, seconds);
+				if (threads == max_threads)
+					break;
+			}
+		}
+
+		tracer.closeLogFile();
+		reportWriter(modes[m], logfile, fileSize(logfile) - size, processCpuSeconds() - cpu);
+		if (!keep)
+			remove(logfile.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,310 @@
+// odbccollector - merges the log lines of all traced processes into one file.
+//
+// Traced processes whose log file name contains "_collector" send their lines
+// in batches (see ODBCCollectorProtocol.h) instead of appending to the shared
+// log file themselves. The collector accepts any number of processes, holds
+// every line back for a short window and writes the lines of all processes
+// ordered by time, so the output has no interleaved or torn lines and the
+// traced processes never wait on a file lock. Lines that arrive after their
+// window has been written are still written, and counted as late. While
+// more than MAXPENDING bytes of lines wait, no more batches are read, so a
+// traced process times out and writes its lines to its own file instead.
+//
+// Usage: odbccollector -o file [-e endpoint] [-w holdback ms]
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../ODBCCollectorProtocol.h"
+
+// Bytes of lines held back at most.
+#define MAXPENDING (256 * 1024 * 1024)
+
+struct Line
+{
+	long long time;
+	unsigned int pid;
+	unsigned int sequence;
+	std::string text;
+};
+
+struct LaterLine
+{
+	bool operator()(const Line &a, const Line &b) const
+	{
+		if (a.time != b.time)
+			return a.time > b.time;
+		if (a.pid != b.pid)
+			return a.pid > b.pid;
+		return a.sequence > b.sequence;
+	}
+};
+
+static std::mutex lock;
+static std::priority_queue<Line, std::vector<Line>, LaterLine> pending;
+static size_t pending_bytes = 0;
+static std::condition_variable drained;
+static long long written_until = 0;
+static unsigned long long batches = 0;
+static unsigned long long late = 0;
+static std::atomic<bool> stopping(false);
+
+#if defined(_WIN32)
+
+typedef HANDLE Connection;
+
+static bool readFully(Connection connection, void *data, size_t size)
+{
+	char *next = (char*)data;
+	while (size > 0)
+	{
+		DWORD read;
+		if (!ReadFile(connection, next, (DWORD)size, &read, NULL) || read == 0)
+			return false;
+		next += read;
+		size -= read;
+	}
+	return true;
+}
+
+static void closeConnection(Connection connection)
+{
+	DisconnectNamedPipe(connection);
+	CloseHandle(connection);
+}
+
+#else
+
+typedef int Connection;
+
+static bool readFully(Connection connection, void *data, size_t size)
+{
+	char *next = (char*)data;
+	while (size > 0)
+	{
+		ssize_t received = recv(connection, next, size, 0);
+		if (received < 0 && errno == EINTR)
+			continue;
+		if (received <= 0)
+			return false;
+		next += received;
+		size -= received;
+	}
+	return true;
+}
+
+static void closeConnection(Connection connection)
+{
+	close(connection);
+}
+
+#endif
+
+static long long wallClockMilliseconds()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Reads the batches of one traced process until it disconnects.
+static void receive(Connection connection)
+{
+	std::vector<char> records;
+	ODBCCollectorBatch batch;
+	while (readFully(connection, &batch, sizeof(batch)))
+	{
+		if (batch.magic != ODBCCOLLECTOR_MAGIC || batch.version != ODBCCOLLECTOR_VERSION || batch.size > ODBCCOLLECTOR_MAXBATCH)
+		{
+			fprintf(stderr, "odbccollector: invalid batch from pid %u, disconnecting\n", batch.pid);
+			break;
+		}
+		records.resize(batch.size);
+		if (!readFully(connection, records.data(), records.size()))
+			break;
+
+		std::unique_lock<std::mutex> guard(lock);
+		drained.wait(guard, []() { return pending_bytes < MAXPENDING || stopping; });
+		batches++;
+		size_t offset = 0;
+		for (unsigned int i = 0; i < batch.count && offset + sizeof(ODBCCollectorRecord) <= records.size(); i++)
+		{
+			ODBCCollectorRecord record;
+			memcpy(&record, &records[offset], sizeof(record));
+			offset += sizeof(record);
+			if (offset + record.length > records.size())
+				break;
+
+			Line line;
+			line.time = record.time;
+			line.pid = batch.pid;
+			line.sequence = record.sequence;
+			line.text.assign(&records[offset], record.length);
+			offset += record.length;
+			if (line.time < written_until)
+				late++;
+			pending_bytes += line.text.size();
+			pending.push(std::move(line));
+		}
+	}
+	closeConnection(connection);
+}
+
+#if defined(_WIN32)
+
+static bool acceptConnections(const std::string &endpoint)
+{
+	for (;;)
+	{
+		HANDLE pipe = CreateNamedPipe(endpoint.c_str(), PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+			PIPE_UNLIMITED_INSTANCES, 0, 1024 * 1024, 0, NULL);
+		if (pipe == INVALID_HANDLE_VALUE)
+		{
+			fprintf(stderr, "odbccollector: cannot create %s\n", endpoint.c_str());
+			return false;
+		}
+		if (ConnectNamedPipe(pipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED)
+			std::thread(receive, pipe).detach();
+		else
+			CloseHandle(pipe);
+	}
+}
+
+#else
+
+static bool acceptConnections(const std::string &endpoint)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, endpoint.c_str(), sizeof(address.sun_path) - 1);
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(endpoint.c_str());
+	if (server < 0 || bind(server, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server, 64) != 0)
+	{
+		fprintf(stderr, "odbccollector: cannot listen on %s\n", endpoint.c_str());
+		return false;
+	}
+	for (;;)
+	{
+		int client = accept(server, NULL, NULL);
+		if (client >= 0)
+			std::thread(receive, client).detach();
+		else if (errno != EINTR)
+			return false;
+	}
+}
+
+#endif
+
+// Writes the lines older than the hold back window, or all of them.
+static unsigned long long writeLines(FILE *output, long long until)
+{
+	unsigned long long lines = 0;
+	std::lock_guard<std::mutex> guard(lock);
+	while (!pending.empty() && pending.top().time <= until)
+	{
+		const Line &line = pending.top();
+		fwrite(line.text.data(), 1, line.text.size(), output);
+		fputc('\n', output);
+		pending_bytes -= line.text.size();
+		pending.pop();
+		lines++;
+	}
+	if (until > written_until)
+		written_until = until;
+	fflush(output);
+	drained.notify_all();
+	return lines;
+}
+
+static void stop(int)
+{
+	stopping = true;
+}
+
+static void usage()
+{
+	fprintf(stderr, "usage: odbccollector -o file [-e endpoint] [-w holdback ms]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	std::string endpoint;
+	long long holdback = 1000;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-o") == 0)
+			path = argv[i + 1];
+		else if (strcmp(argv[i], "-e") == 0)
+			endpoint = argv[i + 1];
+		else if (strcmp(argv[i], "-w") == 0)
+			holdback = atoll(argv[i + 1]);
+		else
+			usage();
+	}
+	if (path == NULL || argc % 2 == 0 || holdback < 0)
+		usage();
+	if (endpoint.empty())
+		endpoint = ODBCCollectorDefaultEndpoint(true);
+	if (endpoint.empty())
+	{
+		fprintf(stderr, "odbccollector: the default endpoint is not private to this user, use -e\n");
+		return 1;
+	}
+
+	FILE *output = fopen(path, "a");
+	if (output == NULL)
+	{
+		fprintf(stderr, "odbccollector: cannot open %s\n", path);
+		return 1;
+	}
+
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	std::thread listener([endpoint]()
+	{
+		if (!acceptConnections(endpoint))
+			stopping = true;
+	});
+	listener.detach();
+
+	unsigned long long lines = 0;
+	while (!stopping)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		lines += writeLines(output, wallClockMilliseconds() - holdback);
+	}
+	lines += writeLines(output, LLONG_MAX);
+	fclose(output);
+
+#if !defined(_WIN32)
+	unlink(endpoint.c_str());
+#endif
+	std::lock_guard<std::mutex> guard(lock);
+	fprintf(stderr, "odbccollector: %llu lines in %llu batches, %llu late\n", lines, batches, late);
+	return 0;
+}
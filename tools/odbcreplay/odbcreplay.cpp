@@ -0,0 +1,361 @@
+// odbcreplay - replays statements captured by ODBCTracer against a DSN.
+//
+// Reads the replay lines the tracer writes when the log file name contains
+// "_replay":
+//   time proc pid replay hdbc <handle> <begin us> <elapsed us> <rows> sql
+// Every traced connection (pid and hdbc) is replayed on its own thread and
+// connection, in the original statement order. Statements start at their
+// original offset from the beginning of the trace, scaled by the speed
+// factor, so think time and the overlap between connections are kept;
+// a speed of 0 runs every connection back to back. Each statement fetches
+// as many rows as the traced application did. The tracer escapes
+// backslashes and line breaks of the statement as "\\", "\n" and "\r".
+//
+// Statements with parameter markers are skipped and counted: the trace
+// does not capture the bound parameter values, without them the statement
+// cannot be executed as it was.
+//
+// Builds with the Windows SDK or against unixODBC (-lodbc), so a trace can
+// be replayed on Linux, e.g. against the SQLite ODBC driver.
+//
+// Usage: odbcreplay -c connection-string [-s speed] [-p pid] [-v] file
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+#include <sql.h>
+#include <sqlext.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+struct ReplayStatement
+{
+	long long begin;
+	long long elapsed;
+	long long rows;
+	std::string sql;
+};
+
+struct ReplayConnection
+{
+	unsigned int pid;
+	std::string hdbc;
+	std::vector<ReplayStatement> statements;
+
+	// Results of the replay
+	unsigned long long executed;
+	unsigned long long skipped;
+	unsigned long long errors;
+	unsigned long long short_fetches;
+	long long original_time;
+	long long replay_time;
+	long long max_lag;
+};
+
+static bool verbose = false;
+static std::mutex output;
+
+static const char* skipToken(const char *p)
+{
+	while (*p && *p != ' ')
+		p++;
+	while (*p == ' ')
+		p++;
+	return p;
+}
+
+// Parses a replay line, the process name in front of the pid may contain spaces.
+static bool parseLine(const char *line, unsigned int *pid, std::string *hdbc, ReplayStatement *statement)
+{
+	const char *marker = strstr(line, " replay hdbc ");
+	if (marker == NULL)
+		return false;
+
+	const char *p = marker;
+	while (p > line && p[-1] != ' ')
+		p--;
+	*pid = (unsigned int)strtoul(p, NULL, 10);
+
+	p = marker + strlen(" replay hdbc ");
+	const char *handle = p;
+	p = skipToken(p);
+	hdbc->assign(handle, p - handle);
+	while (!hdbc->empty() && hdbc->back() == ' ')
+		hdbc->pop_back();
+
+	char *end;
+	statement->begin = strtoll(p, &end, 10);
+	statement->elapsed = strtoll(end, &end, 10);
+	statement->rows = strtoll(end, &end, 10);
+	if (*end != ' ')
+		return false;
+	statement->sql.clear();
+	for (const char *c = end + 1; *c && *c != '\n' && *c != '\r'; c++)
+	{
+		if (*c == '\\' && (c[1] == '\\' || c[1] == 'n' || c[1] == 'r'))
+		{
+			c++;
+			statement->sql.push_back(*c == 'n' ? '\n' : *c == 'r' ? '\r' : '\\');
+		}
+		else
+			statement->sql.push_back(*c);
+	}
+	return !statement->sql.empty();
+}
+
+// A "?" outside string literals, quoted identifiers and comments marks a
+// parameter the trace has no value for.
+static bool hasParameters(const std::string &sql)
+{
+	for (size_t i = 0; i < sql.size(); i++)
+	{
+		char c = sql[i];
+		if (c == '\'' || c == '"')
+		{
+			size_t close = sql.find(c, i + 1);
+			if (close == std::string::npos)
+				return false;
+			i = close;
+		}
+		else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-')
+		{
+			i = sql.find('\n', i);
+			if (i == std::string::npos)
+				return false;
+		}
+		else if (c == '/' && i + 1 < sql.size() && sql[i + 1] == '*')
+		{
+			i = sql.find("*/", i + 2);
+			if (i == std::string::npos)
+				return false;
+			i++;
+		}
+		else if (c == '?')
+			return true;
+	}
+	return false;
+}
+
+static void printError(const char *what, SQLSMALLINT type, SQLHANDLE handle)
+{
+	SQLCHAR state[6];
+	SQLCHAR message[512];
+	SQLINTEGER native;
+	SQLSMALLINT length;
+	if (!SQL_SUCCEEDED(SQLGetDiagRec(type, handle, 1, state, &native, message, sizeof(message), &length)))
+	{
+		state[0] = 0;
+		message[0] = 0;
+	}
+	std::lock_guard<std::mutex> guard(output);
+	fprintf(stderr, "odbcreplay: %s: [%s] %s\n", what, state, message);
+}
+
+static void replay(ReplayConnection *connection, SQLHENV env, const std::string &connection_string,
+	Clock::time_point start, long long trace_start, double speed)
+{
+	SQLHDBC hdbc;
+	SQLHSTMT hstmt;
+	if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_DBC, env, &hdbc)))
+	{
+		connection->errors = connection->statements.size();
+		return;
+	}
+	if (!SQL_SUCCEEDED(SQLDriverConnect(hdbc, NULL, (SQLCHAR*)connection_string.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT)))
+	{
+		printError("connect", SQL_HANDLE_DBC, hdbc);
+		connection->errors = connection->statements.size();
+		SQLFreeHandle(SQL_HANDLE_DBC, hdbc);
+		return;
+	}
+	if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, hdbc, &hstmt)))
+	{
+		printError("statement", SQL_HANDLE_DBC, hdbc);
+		connection->errors = connection->statements.size();
+		SQLDisconnect(hdbc);
+		SQLFreeHandle(SQL_HANDLE_DBC, hdbc);
+		return;
+	}
+
+	for (size_t i = 0; i < connection->statements.size(); i++)
+	{
+		ReplayStatement *statement = &connection->statements[i];
+		if (hasParameters(statement->sql))
+		{
+			connection->skipped++;
+			continue;
+		}
+
+		Clock::time_point due = start;
+		if (speed > 0)
+		{
+			due += std::chrono::microseconds((long long)((statement->begin - trace_start) / speed));
+			std::this_thread::sleep_until(due);
+		}
+
+		Clock::time_point begin = Clock::now();
+		long long lag = std::chrono::duration_cast<std::chrono::microseconds>(begin - due).count();
+		if (speed > 0 && lag > connection->max_lag)
+			connection->max_lag = lag;
+
+		SQLRETURN ret = SQLExecDirect(hstmt, (SQLCHAR*)statement->sql.c_str(), SQL_NTS);
+		if (SQL_SUCCEEDED(ret) || ret == SQL_NO_DATA)
+		{
+			long long fetched = 0;
+			while (fetched < statement->rows && SQL_SUCCEEDED(SQLFetch(hstmt)))
+				fetched++;
+			if (fetched < statement->rows)
+				connection->short_fetches++;
+		}
+		else
+		{
+			connection->errors++;
+			if (verbose)
+				printError(statement->sql.c_str(), SQL_HANDLE_STMT, hstmt);
+		}
+		SQLFreeStmt(hstmt, SQL_CLOSE);
+
+		connection->executed++;
+		connection->original_time += statement->elapsed;
+		connection->replay_time += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin).count();
+	}
+
+	SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+	SQLDisconnect(hdbc);
+	SQLFreeHandle(SQL_HANDLE_DBC, hdbc);
+}
+
+static bool compareBegin(const ReplayStatement &a, const ReplayStatement &b)
+{
+	return a.begin < b.begin;
+}
+
+static void usage()
+{
+	fprintf(stderr, "usage: odbcreplay -c connection-string [-s speed] [-p pid] [-v] file\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	std::string connection_string;
+	double speed = 1;
+	unsigned int only_pid = 0;
+	const char *path = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+			connection_string = argv[++i];
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			speed = atof(argv[++i]);
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+			only_pid = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-v") == 0)
+			verbose = true;
+		else if (argv[i][0] == '-' || path != NULL)
+			usage();
+		else
+			path = argv[i];
+	}
+	if (path == NULL || connection_string.empty() || speed < 0)
+		usage();
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+	{
+		fprintf(stderr, "odbcreplay: cannot open %s\n", path);
+		return 1;
+	}
+
+	std::map<std::pair<unsigned int, std::string>, ReplayConnection> connections;
+	std::vector<char> line(64 * 1024);
+	std::string pending;
+	long long trace_start = 0;
+	unsigned long long total = 0;
+	while (fgets(line.data(), (int)line.size(), file))
+	{
+		// Statements can be longer than the buffer
+		pending.append(line.data());
+		if (pending.back() != '\n' && !feof(file))
+			continue;
+
+		unsigned int pid;
+		std::string hdbc;
+		ReplayStatement statement;
+		if (parseLine(pending.c_str(), &pid, &hdbc, &statement) && (only_pid == 0 || pid == only_pid))
+		{
+			ReplayConnection &connection = connections[std::make_pair(pid, hdbc)];
+			connection.pid = pid;
+			connection.hdbc = hdbc;
+			connection.statements.push_back(statement);
+			if (total == 0 || statement.begin < trace_start)
+				trace_start = statement.begin;
+			total++;
+		}
+		pending.clear();
+	}
+	fclose(file);
+
+	if (total == 0)
+	{
+		fprintf(stderr, "odbcreplay: no replay lines in %s, trace with a log file name containing _replay\n", path);
+		return 1;
+	}
+
+	SQLHENV env;
+	SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &env);
+	SQLSetEnvAttr(env, SQL_ATTR_ODBC_VERSION, (SQLPOINTER)SQL_OV_ODBC3, 0);
+
+	if (speed > 0)
+		printf("replaying %llu statements on %u connections at %gx speed\n", total, (unsigned int)connections.size(), speed);
+	else
+		printf("replaying %llu statements on %u connections at full speed\n", total, (unsigned int)connections.size());
+	fflush(stdout);
+
+	// Give every thread time to connect before the first statement is due
+	Clock::time_point start = Clock::now() + std::chrono::seconds(speed > 0 ? 1 : 0);
+	std::vector<std::thread> threads;
+	for (auto it = connections.begin(); it != connections.end(); ++it)
+	{
+		ReplayConnection *connection = &it->second;
+		std::stable_sort(connection->statements.begin(), connection->statements.end(), compareBegin);
+		connection->executed = connection->skipped = connection->errors = connection->short_fetches = 0;
+		connection->original_time = connection->replay_time = connection->max_lag = 0;
+		threads.push_back(std::thread(replay, connection, env, connection_string, start, trace_start, speed));
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	printf("%7s %-20s %10s %8s %8s %8s %12s %12s %10s\n", "PID", "HDBC", "STMTS", "PARAMS", "ERRORS", "SHORT", "ORIGINAL ms", "REPLAY ms", "MAXLAG ms");
+	unsigned long long errors = 0, skipped = 0;
+	long long original_time = 0, replay_time = 0;
+	for (auto it = connections.begin(); it != connections.end(); ++it)
+	{
+		ReplayConnection *connection = &it->second;
+		printf("%7u %-20.20s %10llu %8llu %8llu %8llu %12.1f %12.1f %10.1f\n", connection->pid, connection->hdbc.c_str(),
+			connection->executed, connection->skipped, connection->errors, connection->short_fetches,
+			connection->original_time / 1000.0, connection->replay_time / 1000.0, connection->max_lag / 1000.0);
+		errors += connection->errors;
+		skipped += connection->skipped;
+		original_time += connection->original_time;
+		replay_time += connection->replay_time;
+	}
+	printf("%llu statements, %llu skipped with parameters, %llu errors, original %.1fms, replay %.1fms, %.2fs wall\n",
+		total, skipped, errors, original_time / 1000.0, replay_time / 1000.0, seconds);
+
+	SQLFreeHandle(SQL_HANDLE_ENV, env);
+	return errors > 0 ? 1 : 0;
+}
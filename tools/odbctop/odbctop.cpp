@@ -0,0 +1,425 @@
+// odbctop - live view of every process traced by ODBCTracer.
+//
+// Reads the metrics segments the tracer publishes (see ODBCMetricsSegment.h)
+// through read-only mappings, so the traced processes do no extra work for
+// it. Every refresh shows per process and per fingerprint statement rate,
+// latency percentiles, rows/sec and error rate over the last interval.
+//
+// Usage: odbctop [-d seconds] [-n refreshes] [-f fingerprints] [-p pid]
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <tlhelp32.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "../../ODBCMetricsSegment.h"
+
+struct TracedProcess
+{
+	unsigned int pid;
+	void *mapping;
+	const ODBCMetricsSegment *segment;
+	bool seen;
+	bool sampled;
+
+	// Values read at the previous refresh
+	long long sample_time;
+	unsigned long long statements;
+	unsigned long long errors;
+	unsigned long long rows;
+	unsigned long long latency[ODBCMETRICS_BUCKETS];
+
+	// Fingerprints of the last two distinct snapshots
+	long long snapshot_time;
+	long long previous_time;
+	std::map<unsigned long long, ODBCMetricsFingerprint> fingerprints;
+	std::map<unsigned long long, ODBCMetricsFingerprint> previous;
+};
+
+struct FingerprintView
+{
+	const ODBCMetricsFingerprint *current;
+	double seconds;
+	unsigned long long executions;
+	unsigned long long total_time;
+	unsigned long long rows;
+	unsigned long long errors;
+	unsigned long long latency[ODBCMETRICS_BUCKETS];
+	unsigned long long cpu_time;
+	unsigned long long cpu_elapsed;
+};
+
+#if defined(_WIN32)
+
+static long long monotonicMilliseconds()
+{
+	return (long long)GetTickCount64();
+}
+
+static const ODBCMetricsSegment* openSegment(unsigned int pid, void **mapping)
+{
+	// Processes without SeCreateGlobalPrivilege publish in their session only
+	HANDLE handle = OpenFileMapping(FILE_MAP_READ, FALSE, (ODBCMETRICS_NAME + std::to_string(pid)).c_str());
+	if (handle == NULL)
+		handle = OpenFileMapping(FILE_MAP_READ, FALSE, (ODBCMETRICS_LOCALNAME + std::to_string(pid)).c_str());
+	if (handle == NULL)
+		return NULL;
+
+	const ODBCMetricsSegment *segment = (const ODBCMetricsSegment*)MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+	if (segment == NULL || segment->magic.load(std::memory_order_acquire) != ODBCMETRICS_MAGIC ||
+		segment->version != ODBCMETRICS_VERSION || segment->size != sizeof(ODBCMetricsSegment))
+	{
+		if (segment != NULL)
+			UnmapViewOfFile(segment);
+		CloseHandle(handle);
+		return NULL;
+	}
+
+	*mapping = handle;
+	return segment;
+}
+
+static void closeSegment(TracedProcess *process)
+{
+	UnmapViewOfFile(process->segment);
+	CloseHandle(process->mapping);
+}
+
+// Every running process, the ones without a segment are skipped by openSegment.
+static void listProcesses(std::vector<unsigned int> &pids)
+{
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE)
+		return;
+	PROCESSENTRY32 entry;
+	entry.dwSize = sizeof(entry);
+	for (BOOL more = Process32First(snapshot, &entry); more; more = Process32Next(snapshot, &entry))
+		pids.push_back(entry.th32ProcessID);
+	CloseHandle(snapshot);
+}
+
+#else
+
+static long long monotonicMilliseconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static const ODBCMetricsSegment* openSegment(unsigned int pid, void **mapping)
+{
+	std::string name = ODBCMETRICS_NAME + std::to_string(pid);
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+
+	struct stat info;
+	void *address = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size == sizeof(ODBCMetricsSegment))
+		address = mmap(NULL, sizeof(ODBCMetricsSegment), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED)
+		return NULL;
+
+	const ODBCMetricsSegment *segment = (const ODBCMetricsSegment*)address;
+	if (segment->magic.load(std::memory_order_acquire) != ODBCMETRICS_MAGIC ||
+		segment->version != ODBCMETRICS_VERSION || segment->size != sizeof(ODBCMetricsSegment))
+	{
+		munmap(address, sizeof(ODBCMetricsSegment));
+		return NULL;
+	}
+
+	*mapping = NULL;
+	return segment;
+}
+
+static void closeSegment(TracedProcess *process)
+{
+	munmap((void*)process->segment, sizeof(ODBCMetricsSegment));
+}
+
+// Processes with a segment in /dev/shm. Segments outlive their process here;
+// the ones of processes that exited are skipped, and removed by the next
+// traced process that starts.
+static void listProcesses(std::vector<unsigned int> &pids)
+{
+	const char *prefix = ODBCMETRICS_NAME + 1;
+	DIR *directory = opendir("/dev/shm");
+	if (directory == NULL)
+		return;
+	for (struct dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory))
+	{
+		if (strncmp(entry->d_name, prefix, strlen(prefix)) != 0)
+			continue;
+		unsigned int pid = (unsigned int)strtoul(entry->d_name + strlen(prefix), NULL, 10);
+		if (kill((pid_t)pid, 0) == 0 || errno != ESRCH)
+			pids.push_back(pid);
+	}
+	closedir(directory);
+}
+
+#endif
+
+// Maps the segment of every traced process not seen before, forgets the ones that exited.
+static void discover(std::map<unsigned int, TracedProcess> &processes, unsigned int only_pid)
+{
+	for (auto it = processes.begin(); it != processes.end(); ++it)
+		it->second.seen = false;
+
+	std::vector<unsigned int> pids;
+	listProcesses(pids);
+	for (size_t i = 0; i < pids.size(); i++)
+	{
+		unsigned int pid = pids[i];
+		if (only_pid != 0 && pid != only_pid)
+			continue;
+
+		auto it = processes.find(pid);
+		if (it != processes.end())
+		{
+			it->second.seen = true;
+			continue;
+		}
+
+		void *mapping;
+		const ODBCMetricsSegment *segment = openSegment(pid, &mapping);
+		if (segment == NULL)
+			continue;
+
+		TracedProcess &process = processes[pid];
+		process.pid = pid;
+		process.mapping = mapping;
+		process.segment = segment;
+		process.seen = true;
+		process.sampled = false;
+		process.snapshot_time = 0;
+		process.previous_time = 0;
+	}
+
+	for (auto it = processes.begin(); it != processes.end(); )
+	{
+		if (!it->second.seen)
+		{
+			closeSegment(&it->second);
+			it = processes.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+// Estimates a percentile in milliseconds from a latency histogram.
+static double percentile(const unsigned long long *latency, double fraction)
+{
+	unsigned long long total = 0;
+	for (int i = 0; i < ODBCMETRICS_BUCKETS; i++)
+		total += latency[i];
+	if (total == 0)
+		return 0;
+
+	unsigned long long target = (unsigned long long)(total * fraction);
+	if (target == 0)
+		target = 1;
+	unsigned long long count = 0;
+	for (int i = 0; i < ODBCMETRICS_BUCKETS; i++)
+	{
+		count += latency[i];
+		if (count >= target)
+			return ODBCMetricsBucketLimit(i) / 1000.0;
+	}
+	return ODBCMetricsBucketLimit(ODBCMETRICS_BUCKETS - 1) / 1000.0;
+}
+
+static double rate(unsigned long long count, double seconds)
+{
+	return seconds > 0 ? count / seconds : 0;
+}
+
+static double percent(unsigned long long part, unsigned long long count)
+{
+	return count > 0 ? 100.0 * part / count : 0;
+}
+
+static bool compareTotalTime(const FingerprintView &a, const FingerprintView &b)
+{
+	return a.total_time > b.total_time;
+}
+
+static void showProcess(TracedProcess *process, int max_fingerprints)
+{
+	const ODBCMetricsSegment *segment = process->segment;
+	long long now = monotonicMilliseconds();
+
+	unsigned long long statements = segment->statements.load(std::memory_order_relaxed);
+	unsigned long long errors = segment->statement_errors.load(std::memory_order_relaxed);
+	unsigned long long rows = segment->rows_fetched.load(std::memory_order_relaxed);
+	unsigned long long latency[ODBCMETRICS_BUCKETS];
+	for (int i = 0; i < ODBCMETRICS_BUCKETS; i++)
+		latency[i] = segment->latency[i].load(std::memory_order_relaxed);
+
+	// Rates cover the last interval, or the whole trace on the first refresh
+	double seconds = process->sampled ? (now - process->sample_time) / 1000.0 : (double)(time(NULL) - segment->start_time);
+	unsigned long long interval_latency[ODBCMETRICS_BUCKETS];
+	for (int i = 0; i < ODBCMETRICS_BUCKETS; i++)
+		interval_latency[i] = latency[i] - (process->sampled ? process->latency[i] : 0);
+	unsigned long long interval_statements = statements - (process->sampled ? process->statements : 0);
+	unsigned long long interval_errors = errors - (process->sampled ? process->errors : 0);
+	unsigned long long interval_rows = rows - (process->sampled ? process->rows : 0);
+
+	printf("%7u %-16.16s %9.1f %10.1f %6.1f %8.1f %8.1f %8.1f %8lld%s\n",
+		process->pid, segment->process,
+		rate(interval_statements, seconds), rate(interval_rows, seconds),
+		percent(interval_errors, interval_statements),
+		percentile(interval_latency, 0.50), percentile(interval_latency, 0.95), percentile(interval_latency, 0.99),
+		segment->in_flight.load(std::memory_order_relaxed),
+		segment->closed.load() ? " (closed)" : "");
+
+	process->sample_time = now;
+	process->statements = statements;
+	process->errors = errors;
+	process->rows = rows;
+	memcpy(process->latency, latency, sizeof(latency));
+	process->sampled = true;
+
+	ODBCMetricsSnapshot snapshot;
+	if (!ODBCMetricsReadSnapshot(segment, &snapshot))
+		return;
+
+	// Fingerprint deltas are taken between the last two distinct snapshots,
+	// the tracer publishes one per second while the process makes calls
+	if (snapshot.time != process->snapshot_time)
+	{
+		process->previous.swap(process->fingerprints);
+		process->previous_time = process->snapshot_time;
+		process->fingerprints.clear();
+		for (unsigned int i = 0; i < snapshot.fingerprint_count && i < ODBCMETRICS_FINGERPRINTS; i++)
+			process->fingerprints[snapshot.fingerprints[i].hash] = snapshot.fingerprints[i];
+		process->snapshot_time = snapshot.time;
+	}
+
+	std::vector<FingerprintView> views;
+	for (unsigned int i = 0; i < snapshot.fingerprint_count && i < ODBCMETRICS_FINGERPRINTS; i++)
+	{
+		const ODBCMetricsFingerprint *current = &snapshot.fingerprints[i];
+		FingerprintView view;
+		view.current = current;
+		view.executions = current->executions;
+		view.total_time = current->total_time;
+		view.rows = current->rows;
+		view.errors = current->errors;
+		view.cpu_time = current->cpu_time;
+		view.cpu_elapsed = current->cpu_elapsed;
+		memcpy(view.latency, current->latency, sizeof(view.latency));
+		view.seconds = (double)(snapshot.time / 1000 - segment->start_time);
+
+		auto previous = process->previous.find(current->hash);
+		if (previous != process->previous.end())
+		{
+			view.executions -= previous->second.executions;
+			view.total_time -= previous->second.total_time;
+			view.rows -= previous->second.rows;
+			view.errors -= previous->second.errors;
+			view.cpu_time -= previous->second.cpu_time;
+			view.cpu_elapsed -= previous->second.cpu_elapsed;
+			for (int b = 0; b < ODBCMETRICS_BUCKETS; b++)
+				view.latency[b] -= previous->second.latency[b];
+			view.seconds = (snapshot.time - process->previous_time) / 1000.0;
+		}
+		if (view.executions > 0)
+			views.push_back(view);
+	}
+	std::sort(views.begin(), views.end(), compareTotalTime);
+
+	for (int i = 0; i < (int)views.size() && i < max_fingerprints; i++)
+	{
+		FingerprintView *view = &views[i];
+		printf("%25s%9.1f %10.1f %6.1f %8.1f %8.1f %8.1f %6.1f  %.60s\n", "",
+			rate(view->executions, view->seconds), rate(view->rows, view->seconds),
+			percent(view->errors, view->executions),
+			percentile(view->latency, 0.50), percentile(view->latency, 0.95), percentile(view->latency, 0.99),
+			percent(view->cpu_time, view->cpu_elapsed), view->current->text);
+	}
+}
+
+static void usage()
+{
+	fprintf(stderr, "usage: odbctop [-d seconds] [-n refreshes] [-f fingerprints] [-p pid]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	double delay = 1;
+	int refreshes = 0;
+	int max_fingerprints = 5;
+	unsigned int only_pid = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+			usage();
+		if (strcmp(argv[i], "-d") == 0)
+			delay = atof(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0)
+			refreshes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-f") == 0)
+			max_fingerprints = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-p") == 0)
+			only_pid = (unsigned int)atoi(argv[++i]);
+		else
+			usage();
+	}
+	if (delay <= 0)
+		usage();
+
+#if defined(_WIN32)
+	HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+	DWORD mode;
+	if (GetConsoleMode(console, &mode))
+		SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+
+	std::map<unsigned int, TracedProcess> processes;
+	for (int refresh = 0; refreshes == 0 || refresh < refreshes; refresh++)
+	{
+		discover(processes, only_pid);
+
+		time_t now = time(NULL);
+		char clock[16];
+		strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&now));
+
+		printf("\x1b[H\x1b[2J");
+		printf("odbctop - %u traced processes%*s\n\n", (unsigned int)processes.size(), 50, clock);
+		printf("%7s %-16s %9s %10s %6s %8s %8s %8s %8s\n", "PID", "PROCESS", "STMT/S", "ROWS/S", "ERR%", "P50ms", "P95ms", "P99ms", "INFLIGHT");
+		printf("%25s%9s %10s %6s %8s %8s %8s %6s  %s\n", "", "EXEC/S", "ROWS/S", "ERR%", "P50ms", "P95ms", "P99ms", "CPU%", "FINGERPRINT");
+		for (auto it = processes.begin(); it != processes.end(); ++it)
+			showProcess(&it->second, max_fingerprints);
+		fflush(stdout);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds((long long)(delay * 1000)));
+	}
+
+	for (auto it = processes.begin(); it != processes.end(); ++it)
+		closeSegment(&it->second);
+	return 0;
+}